@@ -0,0 +1,223 @@
+/*
+    Copyright (C) 2020 Akib Azmain
+    
+    This file is a part of Docview.
+    
+    Docview is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    Docview is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with Docview. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+    Synthetic extension for docview-bench, written against the C extension
+    interface (extension_functions). It's compiled as C++ only because
+    docview.h uses a default member initializer, the code itself is plain C.
+
+    It parses *.bench files, every line of which is a node. The number of
+    leading spaces is the depth of node, and text after '|' is a synonym.
+*/
+
+#include <docview.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+extern "C"
+{
+
+/* Memory of a parsed document, all documents are freed when extension is unloaded */
+struct bench_document
+{
+    struct bench_document* next;
+    char* text;
+    struct docview_extension_doc_tree_node* nodes;
+    const struct docview_extension_doc_tree_node** children;
+    const char** synonyms;
+};
+
+/* All parsed documents */
+static struct bench_document* documents = NULL;
+
+/* Buffer holding strings returned to libdocview, libdocview copies them before next call */
+static char buffer[4096];
+
+static void free_documents() __attribute__((destructor));
+
+static void free_documents()
+{
+    while (documents)
+    {
+        struct bench_document* next = documents->next;
+        free(documents->text);
+        free(documents->nodes);
+        free(documents->children);
+        free(documents->synonyms);
+        free(documents);
+        documents = next;
+    }
+}
+
+static enum docview_extension_applicability_level get_applicability_level()
+{
+    return docview_extension_applicability_level_small;
+}
+
+static const struct docview_extension_doc_tree_node* get_doc_tree(const char* path)
+{
+
+    /* Only *.bench files are documents */
+    size_t path_length = strlen(path);
+    if (path_length < 6 || strcmp(path + path_length - 6, ".bench") != 0)
+        return NULL;
+
+    FILE* file = fopen(path, "rb");
+    if (!file)
+        return NULL;
+
+    /* Read whole file, followed by the file name which is the title of root */
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    const char* name = strrchr(path, '/') ? strrchr(path, '/') + 1 : path;
+    char* text = (char*)malloc(size + 1 + strlen(name) + 1);
+    if (!text || fread(text, 1, size, file) != (size_t)size)
+    {
+        free(text);
+        fclose(file);
+        return NULL;
+    }
+    fclose(file);
+    text[size] = '\n';
+    strcpy(text + size + 1, name);
+
+    /* Count nodes, every line is a node, plus the root */
+    size_t node_count = 1;
+    for (long i = 0; i < size; i++)
+        if (text[i] == '\n')
+            node_count++;
+    if (size > 0 && text[size - 1] != '\n')
+        node_count++;
+
+    struct bench_document* document = (struct bench_document*)malloc(sizeof(struct bench_document));
+    document->text = text;
+    document->nodes = (struct docview_extension_doc_tree_node*)calloc(
+        node_count, sizeof(struct docview_extension_doc_tree_node)
+    );
+    document->children = (const struct docview_extension_doc_tree_node**)calloc(
+        node_count * 2, sizeof(struct docview_extension_doc_tree_node*)
+    );
+    document->synonyms = (const char**)calloc(node_count * 2, sizeof(const char*));
+    size_t* depths = (size_t*)calloc(node_count, sizeof(size_t));
+    size_t* parents = (size_t*)calloc(node_count, sizeof(size_t));
+    size_t* child_counts = (size_t*)calloc(node_count, sizeof(size_t));
+    size_t* stack = (size_t*)calloc(node_count + 1, sizeof(size_t));
+
+    /* First pass, split lines and find parent of each node */
+    struct docview_extension_doc_tree_node* nodes = document->nodes;
+    nodes[0].title = text + size + 1;
+    size_t node = 1;
+    size_t stack_size = 1;
+    char* line = text;
+    while (line < text + size)
+    {
+        char* end = (char*)memchr(line, '\n', text + size + 1 - line);
+        *end = '\0';
+
+        /* Depth is the number of leading spaces, a node can't be deeper than it's parent's child */
+        size_t depth = 0;
+        while (line[depth] == ' ')
+            depth++;
+        if (depth + 1 > stack_size)
+            depth = stack_size - 1;
+
+        depths[node] = depth;
+        parents[node] = stack[depth];
+        child_counts[stack[depth]]++;
+        stack[depth + 1] = node;
+        stack_size = depth + 2;
+
+        /* Title is the line without indentation, synonym follows '|' */
+        char* bar = strchr(line + depth, '|');
+        if (bar)
+        {
+            *bar = '\0';
+            document->synonyms[node * 2] = bar + 1;
+        }
+        nodes[node].title = line + depth;
+
+        node++;
+        line = end + 1;
+    }
+
+    /* Second pass, place every node in it's parent's NULL terminated children array */
+    size_t offset = 0;
+    size_t* filled = depths;
+    for (size_t i = 0; i < node_count; i++)
+    {
+        nodes[i].children = document->children + offset;
+        nodes[i].synonyms = document->synonyms + i * 2;
+        offset += child_counts[i] + 1;
+        filled[i] = 0;
+    }
+    for (size_t i = 1; i < node_count; i++)
+    {
+        nodes[i].parent = &nodes[parents[i]];
+        ((const struct docview_extension_doc_tree_node**)nodes[parents[i]].children)[filled[parents[i]]++] =
+            &nodes[i];
+    }
+
+    free(depths);
+    free(parents);
+    free(child_counts);
+    free(stack);
+
+    document->next = documents;
+    documents = document;
+    return &nodes[0];
+}
+
+static struct docview_document get_doc(const struct docview_extension_doc_tree_node* node)
+{
+    snprintf(buffer, sizeof(buffer), "<h1>%s</h1>", node->title);
+    struct docview_document document = {buffer, false};
+    return document;
+}
+
+static const char* get_brief(const struct docview_extension_doc_tree_node* node)
+{
+    snprintf(buffer, sizeof(buffer), "Brief of %s", node->title);
+    return buffer;
+}
+
+static const char* get_details(const struct docview_extension_doc_tree_node* node)
+{
+    snprintf(buffer, sizeof(buffer), "Details of %s", node->title);
+    return buffer;
+}
+
+static const char* get_section(const struct docview_extension_doc_tree_node* node, const char* section)
+{
+    snprintf(buffer, sizeof(buffer), "%s of %s", section, node->title);
+    return buffer;
+}
+
+struct docview_extension_functions extension_functions =
+{
+    get_applicability_level,
+    get_doc_tree,
+    get_doc,
+    get_brief,
+    get_details,
+    get_section
+};
+
+}
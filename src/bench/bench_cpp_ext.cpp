@@ -0,0 +1,124 @@
+/*
+    Copyright (C) 2020 Akib Azmain
+    
+    This file is a part of Docview.
+    
+    Docview is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    Docview is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with Docview. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+    Synthetic extension for docview-bench, written against the C++ extension
+    interface (extension_object). It parses the same *.bench files as
+    bench_c_ext.cpp, and can be called from several threads at once.
+*/
+
+#include <docview.hpp>
+#include <fstream>
+#include <list>
+#include <mutex>
+
+class bench_extension : public docview::extension
+{
+private:
+
+    // All parsed nodes, a list keeps them at same address
+    std::list<docview::doc_tree_node> nodes;
+
+    // Mutex guarding nodes
+    std::mutex nodes_mutex;
+
+public:
+
+    applicability_level get_applicability_level() noexcept
+    {
+        return applicability_level::small;
+    }
+
+    const docview::doc_tree_node* get_doc_tree(std::filesystem::path path) noexcept
+    {
+
+        // Only *.bench files are documents
+        if (path.extension() != ".bench")
+            return nullptr;
+
+        std::ifstream file(path);
+        if (!file)
+            return nullptr;
+
+        // Parse into a local list, so that other threads aren't blocked meanwhile
+        std::list<docview::doc_tree_node> document;
+        document.emplace_back();
+        document.back().title = path.filename();
+
+        // Stack of nodes on path from root to last node
+        std::vector<docview::doc_tree_node*> stack{&document.back()};
+
+        std::string line;
+        while (std::getline(file, line))
+        {
+
+            // Depth is the number of leading spaces, a node can't be deeper than it's parent's child
+            std::size_t depth = line.find_first_not_of(' ');
+            if (depth == std::string::npos)
+                depth = line.size();
+            if (depth + 1 > stack.size())
+                depth = stack.size() - 1;
+            stack.resize(depth + 1);
+
+            document.emplace_back();
+            docview::doc_tree_node* node = &document.back();
+
+            // Title is the line without indentation, synonym follows '|'
+            std::size_t bar = line.find('|', depth);
+            node->title = line.substr(depth, bar == std::string::npos ? std::string::npos : bar - depth);
+            if (bar != std::string::npos)
+                node->synonyms.push_back(line.substr(bar + 1));
+
+            node->parent = stack.back();
+            stack.back()->children.push_back(node);
+            stack.push_back(node);
+        }
+
+        docview::doc_tree_node* root = &document.front();
+        std::lock_guard<std::mutex> lock(nodes_mutex);
+        nodes.splice(nodes.end(), document);
+        return root;
+    }
+
+    std::pair<std::string, bool> get_doc(const docview::doc_tree_node* node) noexcept
+    {
+        return std::make_pair("<h1>" + node->title + "</h1>", false);
+    }
+
+    std::string brief(const docview::doc_tree_node* node) noexcept
+    {
+        return "Brief of " + node->title;
+    }
+
+    std::string details(const docview::doc_tree_node* node) noexcept
+    {
+        return "Details of " + node->title;
+    }
+
+    std::string section(const docview::doc_tree_node* node, std::string section) noexcept
+    {
+        return section + " of " + node->title;
+    }
+};
+
+extern "C"
+{
+    bench_extension extension_object;
+    extern const bool extension_thread_safe = true;
+}
@@ -0,0 +1,436 @@
+/*
+    Copyright (C) 2020 Akib Azmain
+    
+    This file is a part of Docview.
+    
+    Docview is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    Docview is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with Docview. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+    docview-bench, end-to-end benchmark of libdocview
+
+    Generates a directory of synthetic documents, then for every synthetic
+    extension measures load_ext, get_doc_tree, get_doc_trees, get_doc, brief,
+    section and unload_ext. Each extension is measured in a child process of
+    it's own, so that peak memory of one doesn't show up in the other. Results
+    are printed to standard output as JSON.
+
+    Usage: docview-bench [--documents N] [--nodes N] [--directory DIR]
+                         [--c-extension PATH] [--cpp-extension PATH]
+*/
+
+#include <docview.hpp>
+#include <chrono>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <functional>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+#include <cctype>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+/**
+ * @brief Latencies of repeated calls to an operation
+ *
+ */
+class measurement
+{
+private:
+
+    // Latency of every call, in nanoseconds
+    std::vector<double> latencies;
+
+    // Wall time of all calls, in nanoseconds
+    double total;
+
+    // Number of items processed by a batch, zero if calls were timed one by one
+    unsigned long batch_count;
+
+public:
+
+    measurement()
+        : latencies(),
+        total(0),
+        batch_count(0)
+    {
+    }
+
+    /**
+     * @brief Calls a function and records it's latency
+     *
+     * @param function the function to call
+     */
+    void time(const std::function<void()>& function)
+    {
+        auto begin = std::chrono::steady_clock::now();
+        function();
+        double latency = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+        latencies.push_back(latency);
+        total += latency;
+    }
+
+    /**
+     * @brief Records a single operation covering given number of items
+     *
+     * @details Latency of single items isn't known, so only the total and
+     * throughput are reported, without percentiles.
+     *
+     * @param count number of items processed
+     * @param function the function to call
+     */
+    void time_batch(unsigned long count, const std::function<void()>& function)
+    {
+        auto begin = std::chrono::steady_clock::now();
+        function();
+        total = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+        batch_count = count;
+    }
+
+    /**
+     * @brief Returns the measurement as a JSON object
+     *
+     * @return JSON object
+     */
+    std::string json()
+    {
+        if (batch_count)
+        {
+            std::stringstream json;
+            json << std::fixed << "{\"count\": " << batch_count
+                << ", \"seconds\": " << std::setprecision(6) << total / 1e9
+                << ", \"ops_per_second\": " << std::setprecision(1) << (total ? batch_count * 1e9 / total : 0)
+                << "}";
+            return json.str();
+        }
+
+        std::sort(latencies.begin(), latencies.end());
+        auto percentile = [&](double p) -> double
+        {
+            if (latencies.empty()) return 0;
+            return latencies[std::min(latencies.size() - 1, (std::size_t)(p * latencies.size()))] / 1000;
+        };
+
+        std::stringstream json;
+        json << std::fixed << std::setprecision(3)
+            << "{\"count\": " << latencies.size()
+            << ", \"seconds\": " << std::setprecision(6) << total / 1e9
+            << ", \"ops_per_second\": " << std::setprecision(1) << (total ? latencies.size() * 1e9 / total : 0)
+            << std::setprecision(3)
+            << ", \"p50_us\": " << percentile(0.5)
+            << ", \"p90_us\": " << percentile(0.9)
+            << ", \"p99_us\": " << percentile(0.99)
+            << ", \"max_us\": " << percentile(1)
+            << "}";
+        return json.str();
+    }
+};
+
+/**
+ * @brief Returns a string quoted and escaped as JSON string
+ *
+ * @param string the string
+ * @return JSON string
+ */
+std::string json_string(const std::string& string)
+{
+    std::stringstream json;
+    json << '"';
+    for (unsigned char character : string)
+    {
+        switch (character)
+        {
+        case '"': json << "\\\""; break;
+        case '\\': json << "\\\\"; break;
+        case '\n': json << "\\n"; break;
+        case '\r': json << "\\r"; break;
+        case '\t': json << "\\t"; break;
+        default:
+            if (character < 0x20)
+                json << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int)character << std::dec;
+            else
+                json << character;
+        }
+    }
+    json << '"';
+    return json.str();
+}
+
+/**
+ * @brief Returns peak resident set size of the process in kilobytes
+ *
+ * @return peak RSS
+ */
+long peak_rss()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+/**
+ * @brief Parses a non-negative decimal number given by the user
+ *
+ * @param text the text to parse
+ * @param number where to store the number
+ * @return true on success, false if text isn't a number or is out of range
+ */
+bool parse_number(const std::string& text, unsigned long& number)
+{
+    if (text.empty() || !std::isdigit((unsigned char)text[0]))
+        return false;
+    char* end;
+    errno = 0;
+    number = std::strtoul(text.c_str(), &end, 10);
+    return *end == '\0' && errno == 0;
+}
+
+/**
+ * @brief Writes synthetic documents to given directory
+ *
+ * @param directory the directory
+ * @param documents number of documents
+ * @param nodes number of nodes in each document
+ */
+void generate_documents(std::filesystem::path directory, unsigned long documents, unsigned long nodes)
+{
+    std::filesystem::create_directories(directory);
+    for (unsigned long document = 0; document < documents; document++)
+    {
+        std::ofstream file(directory / ("doc" + std::to_string(document) + ".bench"));
+
+        // Depth cycles through 0, 1, 2, so that every node is a valid child of previous one
+        for (unsigned long node = 0; node < nodes; node++)
+            file << std::string(node % 3, ' ') << "symbol_" << document << "_" << node
+                << "|alias_" << document << "_" << node << "\n";
+    }
+}
+
+/**
+ * @brief Collects all nodes of a tree
+ *
+ * @param node root of the tree
+ * @param nodes vector to append nodes to
+ */
+void collect_nodes(const docview::doc_tree_node* node, std::vector<const docview::doc_tree_node*>& nodes)
+{
+    nodes.push_back(node);
+    for (auto child : node->children)
+        collect_nodes(child, nodes);
+}
+
+/**
+ * @brief Benchmarks an extension, returns the results as a JSON object
+ *
+ * @param extension path to the extension
+ * @param files documents to parse
+ * @return results as JSON
+ */
+std::string bench_extension(std::filesystem::path extension, const std::vector<std::filesystem::path>& files)
+{
+    measurement load_ext, get_doc_tree, get_doc_trees, get_doc, brief, section, unload_ext;
+
+    load_ext.time([&]() -> void { docview::load_ext(extension); });
+
+    // Parse one by one first, then release them and parse in a batch
+    std::vector<const docview::doc_tree_node*> roots;
+    for (auto& file : files)
+        get_doc_tree.time([&]() -> void { roots.push_back(docview::get_doc_tree(file)); });
+    for (auto root : roots)
+        if (root)
+            docview::release_doc_tree(root);
+    get_doc_trees.time_batch(files.size(), [&]() -> void { roots = docview::get_doc_trees(files); });
+
+    // Query every node of the parsed trees
+    std::vector<const docview::doc_tree_node*> nodes;
+    for (auto root : roots)
+        if (root)
+            collect_nodes(root, nodes);
+    for (auto node : nodes)
+        get_doc.time([&]() -> void { docview::get_doc(node); });
+    for (auto node : nodes)
+        brief.time([&]() -> void { docview::brief(node); });
+    for (auto node : nodes)
+        section.time([&]() -> void { docview::section(node, "Synopsis"); });
+
+    unload_ext.time([&]() -> void { docview::unload_ext(extension); });
+
+    std::stringstream json;
+    json << "{\"extension\": " << json_string(extension.string())
+        << ", \"nodes\": " << nodes.size()
+        << ", \"load_ext\": " << load_ext.json()
+        << ", \"get_doc_tree\": " << get_doc_tree.json()
+        << ", \"get_doc_trees\": " << get_doc_trees.json()
+        << ", \"get_doc\": " << get_doc.json()
+        << ", \"brief\": " << brief.json()
+        << ", \"section\": " << section.json()
+        << ", \"unload_ext\": " << unload_ext.json()
+        << ", \"peak_rss_kb\": " << peak_rss()
+        << "}";
+    return json.str();
+}
+
+/**
+ * @brief Benchmarks an extension in a child process, returns the results as a JSON object
+ *
+ * @details The child starts with the small footprint of this process, so it's
+ * peak RSS belongs to the extension alone. libdocview's thread pool must not be
+ * started before this, otherwise the child would inherit a pool without threads.
+ *
+ * @param extension path to the extension
+ * @param files documents to parse
+ * @return results as JSON
+ */
+std::string bench_extension_in_child(std::filesystem::path extension, const std::vector<std::filesystem::path>& files)
+{
+    int pipe_fds[2];
+    if (pipe(pipe_fds) != 0)
+        return "{\"error\": " + json_string(std::strerror(errno)) + "}";
+
+    // Output buffered till now must not be written twice
+    std::cout.flush();
+    pid_t child = fork();
+    if (child < 0)
+    {
+        close(pipe_fds[0]);
+        close(pipe_fds[1]);
+        return "{\"error\": " + json_string(std::strerror(errno)) + "}";
+    }
+
+    // Child writes the results to the pipe
+    if (child == 0)
+    {
+        close(pipe_fds[0]);
+        std::string results;
+        try
+        {
+            results = bench_extension(extension, files);
+        }
+        catch (std::exception& exception)
+        {
+            results = "{\"error\": " + json_string(exception.what()) + "}";
+        }
+        for (std::size_t written = 0; written < results.size();)
+        {
+            ssize_t count = write(pipe_fds[1], results.data() + written, results.size() - written);
+            if (count <= 0) _exit(1);
+            written += count;
+        }
+        _exit(0);
+    }
+
+    // Parent reads them till the child exits
+    close(pipe_fds[1]);
+    std::string results;
+    char buffer[4096];
+    ssize_t count;
+    while ((count = read(pipe_fds[0], buffer, sizeof(buffer))) > 0 || (count < 0 && errno == EINTR))
+        if (count > 0)
+            results.append(buffer, count);
+    close(pipe_fds[0]);
+
+    int status;
+    while (waitpid(child, &status, 0) < 0 && errno == EINTR);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0 || results.empty())
+        return "{\"error\": " + json_string(
+            WIFSIGNALED(status) ? std::string("killed by signal ") + strsignal(WTERMSIG(status)) :
+            std::string("benchmark process failed")
+        ) + "}";
+    return results;
+}
+
+int main(int argc, char** argv)
+{
+    unsigned long documents = 1000;
+    unsigned long nodes = 50;
+    std::filesystem::path directory;
+    std::vector<std::pair<std::string, std::filesystem::path>> extensions = {
+        {"c", BENCH_C_EXTENSION},
+        {"cpp", BENCH_CPP_EXTENSION}
+    };
+
+    // Parse arguments
+    std::string usage = std::string("Usage: ") + argv[0] + " [--documents N] [--nodes N] [--directory DIR]"
+        + " [--c-extension PATH] [--cpp-extension PATH]";
+    for (int i = 1; i < argc; i++)
+    {
+        std::string argument = argv[i];
+        if (i + 1 >= argc)
+        {
+            std::cerr << usage << std::endl;
+            return 1;
+        }
+        if (argument == "--documents" || argument == "--nodes")
+        {
+            if (!parse_number(argv[++i], argument == "--documents" ? documents : nodes))
+            {
+                std::cerr << "Invalid number of " << argument.substr(2) << ": " << argv[i] << "\n"
+                    << usage << std::endl;
+                return 1;
+            }
+        }
+        else if (argument == "--directory")
+            directory = argv[++i];
+        else if (argument == "--c-extension")
+            extensions[0].second = argv[++i];
+        else if (argument == "--cpp-extension")
+            extensions[1].second = argv[++i];
+        else
+        {
+            std::cerr << "Unknown argument: " << argument << std::endl;
+            return 1;
+        }
+    }
+
+    // Generate documents in a temporary directory unless one is given
+    bool temporary = directory.empty();
+    if (temporary)
+    {
+        std::string pattern = (std::filesystem::temp_directory_path() / "docview-bench-XXXXXX").string();
+        if (!mkdtemp(pattern.data()))
+        {
+            std::cerr << "Failed to create temporary directory: " << std::strerror(errno) << std::endl;
+            return 1;
+        }
+        directory = pattern;
+    }
+    generate_documents(directory, documents, nodes);
+
+    // List documents without find_documents, which would start the thread pool before forking
+    std::vector<std::filesystem::path> files;
+    for (auto& entry : std::filesystem::directory_iterator(directory))
+        if (entry.is_regular_file())
+            files.push_back(entry.path());
+
+    // Run benchmarks, one extension at a time, as both parse same documents, peak_rss_kb at the end is of
+    // this process only
+    std::cout << "{\"documents\": " << files.size() << ", \"nodes_per_document\": " << nodes
+        << ", \"extensions\": {";
+    for (unsigned long i = 0; i < extensions.size(); i++)
+        std::cout << (i ? ", " : "") << json_string(extensions[i].first) << ": "
+            << bench_extension_in_child(extensions[i].second, files);
+    std::cout << "}, \"peak_rss_kb\": " << peak_rss() << "}" << std::endl;
+
+    if (temporary)
+        std::filesystem::remove_all(directory);
+    return 0;
+}
@@ -0,0 +1,666 @@
+/*
+    Copyright (C) 2020 Akib Azmain
+    
+    This file is a part of Docview.
+    
+    Docview is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    Docview is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with Docview. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+    docview-cli, headless front end of libdocview
+
+    Loads extensions from extension search paths, scans documentation search
+    paths like Docview does, then runs a subcommand. All output is JSON.
+*/
+
+#include <docview.hpp>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdlib>
+#include <cctype>
+#include <cerrno>
+#include <limits>
+
+// Usage message
+static const char* usage =
+    "Usage: docview-cli [OPTION]... COMMAND [ARGUMENT]...\n"
+    "\n"
+    "Options:\n"
+    "  -e, --extension-path DIR      load extensions from DIR, may be repeated\n"
+    "  -d, --documentation-path DIR  scan DIR for documents, may be repeated\n"
+    "      --depth N                 walk documentation paths N levels deep, 0 for\n"
+    "                                unlimited (default 1)\n"
+    "\n"
+    "Without -e or -d, colon separated DOCVIEW_EXTENSION_PATH and\n"
+    "DOCVIEW_DOCUMENTATION_PATH environment variables are used.\n"
+    "\n"
+    "Commands:\n"
+    "  search QUERY [LIMIT]    search titles and synonyms of all documents\n"
+    "  lookup NAME [LIMIT]     find nodes whose title or a synonym is exactly NAME\n"
+    "  contains QUERY [LIMIT]  find nodes whose title or a synonym contains QUERY\n"
+    "  fuzzy QUERY [DISTANCE]  find nodes whose title or a synonym is within edit\n"
+    "                          DISTANCE of QUERY (default 1), nearest first\n"
+    "  regex PATTERN [LIMIT]   find nodes whose title or a synonym matches PATTERN\n"
+    "  path QUERY [LIMIT]      search scoped by ancestors, like \"Window::set_title\"\n"
+    "                          or \"gtk > Window > set\"\n"
+    "  dump-tree [FILE]...     print document trees of FILEs, or of all documents\n"
+    "  get FILE [TITLE]...     print the document reached from root of FILE by\n"
+    "                          following children with given TITLEs\n"
+    "  within FILE [TITLE]... QUERY\n"
+    "                          search only the subtree reached like get\n"
+    "  index                   parse all documents and print statistics\n"
+    "  bench [QUERIES]         measure parsing, search and document fetching\n"
+    "  publish NAME            parse all documents and publish them as shared\n"
+    "                          index NAME\n"
+    "  shared-search NAME QUERY [LIMIT]\n"
+    "                          search shared index NAME published by any process,\n"
+    "                          without loading extensions\n";
+
+/**
+ * @brief Returns a string quoted and escaped as JSON string
+ *
+ * @param string the string
+ * @return JSON string
+ */
+std::string json_string(const std::string& string)
+{
+    std::stringstream json;
+    json << '"';
+    for (unsigned char character : string)
+    {
+        switch (character)
+        {
+        case '"': json << "\\\""; break;
+        case '\\': json << "\\\\"; break;
+        case '\n': json << "\\n"; break;
+        case '\r': json << "\\r"; break;
+        case '\t': json << "\\t"; break;
+        default:
+            if (character < 0x20)
+                json << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int)character << std::dec;
+            else
+                json << character;
+        }
+    }
+    json << '"';
+    return json.str();
+}
+
+/**
+ * @brief Parses a non-negative decimal number given by the user
+ *
+ * @param text the text to parse
+ * @param number where to store the number
+ * @return true on success, false if text isn't a number or is out of range
+ */
+bool parse_number(const std::string& text, unsigned long& number)
+{
+    if (text.empty() || !std::isdigit((unsigned char)text[0]))
+        return false;
+    char* end;
+    errno = 0;
+    number = std::strtoul(text.c_str(), &end, 10);
+    return *end == '\0' && errno == 0;
+}
+
+/**
+ * @brief Splits a colon separated list of paths
+ *
+ * @param list the list, may be nullptr
+ * @return the paths
+ */
+std::vector<std::filesystem::path> split_paths(const char* list)
+{
+    std::vector<std::filesystem::path> paths;
+    std::string path;
+    std::stringstream stream(list ? list : "");
+    while (std::getline(stream, path, ':'))
+        if (!path.empty())
+            paths.push_back(path);
+    return paths;
+}
+
+/**
+ * @brief Returns titles of nodes on path from root to a node
+ *
+ * @param node the node
+ * @return titles, root first
+ */
+std::vector<std::string> node_path(const docview::doc_tree_node* node)
+{
+    std::vector<std::string> titles;
+    for (; node; node = node->parent)
+        titles.push_back(node->title);
+    std::reverse(titles.begin(), titles.end());
+    return titles;
+}
+
+/**
+ * @brief Returns a node as JSON object, with children if asked
+ *
+ * @param node the node
+ * @param recursive whether to include children
+ * @return JSON object
+ */
+std::string node_json(const docview::doc_tree_node* node, bool recursive)
+{
+    std::stringstream json;
+    json << "{\"title\": " << json_string(node->title) << ", \"synonyms\": [";
+    for (unsigned long i = 0; i < node->synonyms.size(); i++)
+        json << (i ? ", " : "") << json_string(node->synonyms[i]);
+    json << "]";
+    if (recursive)
+    {
+        json << ", \"children\": [";
+        for (unsigned long i = 0; i < node->children.size(); i++)
+            json << (i ? ", " : "") << node_json(node->children[i], true);
+        json << "]";
+    }
+    json << "}";
+    return json.str();
+}
+
+/**
+ * @brief Returns given latencies as JSON object
+ *
+ * @param latencies latencies in nanoseconds
+ * @return JSON object
+ */
+std::string latency_json(std::vector<double> latencies)
+{
+    std::sort(latencies.begin(), latencies.end());
+    double total = 0;
+    for (auto latency : latencies)
+        total += latency;
+    auto percentile = [&](double p) -> double
+    {
+        if (latencies.empty()) return 0;
+        return latencies[std::min(latencies.size() - 1, (std::size_t)(p * latencies.size()))] / 1000;
+    };
+
+    std::stringstream json;
+    json << std::fixed << std::setprecision(3)
+        << "{\"count\": " << latencies.size()
+        << ", \"ops_per_second\": " << std::setprecision(1) << (total ? latencies.size() * 1e9 / total : 0)
+        << std::setprecision(3)
+        << ", \"p50_us\": " << percentile(0.5)
+        << ", \"p90_us\": " << percentile(0.9)
+        << ", \"p99_us\": " << percentile(0.99)
+        << ", \"max_us\": " << percentile(1)
+        << "}";
+    return json.str();
+}
+
+/**
+ * @brief Returns seconds elapsed since given time
+ *
+ * @param begin the time
+ * @return seconds
+ */
+double seconds_since(std::chrono::steady_clock::time_point begin)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::filesystem::path> extension_paths;
+    std::vector<std::filesystem::path> documentation_paths;
+    unsigned int depth = 1;
+
+    // Parse options
+    int argi = 1;
+    for (; argi < argc && argv[argi][0] == '-'; argi++)
+    {
+        std::string option = argv[argi];
+        if (option == "-h" || option == "--help")
+        {
+            std::cout << usage;
+            return 0;
+        }
+        if (argi + 1 >= argc)
+        {
+            std::cerr << usage;
+            return 1;
+        }
+        if (option == "-e" || option == "--extension-path")
+            extension_paths.push_back(argv[++argi]);
+        else if (option == "-d" || option == "--documentation-path")
+            documentation_paths.push_back(argv[++argi]);
+        else if (option == "--depth")
+        {
+            unsigned long number;
+            if (!parse_number(argv[++argi], number) || number > std::numeric_limits<unsigned int>::max())
+            {
+                std::cerr << "Invalid depth: " << argv[argi] << "\n" << usage;
+                return 1;
+            }
+            depth = number;
+        }
+        else
+        {
+            std::cerr << "Unknown option: " << option << "\n" << usage;
+            return 1;
+        }
+    }
+    if (argi >= argc)
+    {
+        std::cerr << usage;
+        return 1;
+    }
+    std::string command = argv[argi++];
+    std::vector<std::string> arguments(argv + argi, argv + argc);
+
+    // Searching a shared index needs nothing from this process
+    if (command == "shared-search")
+    {
+        if (arguments.size() < 2)
+        {
+            std::cerr << usage;
+            return 1;
+        }
+        unsigned long limit = 0;
+        if (arguments.size() > 2 && !parse_number(arguments[2], limit))
+        {
+            std::cerr << "Invalid limit: " << arguments[2] << "\n" << usage;
+            return 1;
+        }
+        try
+        {
+            docview::shared_index index(arguments[0]);
+            auto results = index.search(arguments[1]);
+            if (limit && results.size() > limit)
+                results.resize(limit);
+
+            std::cout << "[";
+            for (unsigned long i = 0; i < results.size(); i++)
+            {
+                std::vector<std::string> titles;
+                for (unsigned long node = results[i]; node != docview::shared_index::npos; node = index.parent(node))
+                    titles.insert(titles.begin(), index.title(node));
+                std::cout << (i ? ",\n " : "") << "{\"title\": " << json_string(titles.back()) << ", \"path\": [";
+                for (unsigned long j = 0; j < titles.size(); j++)
+                    std::cout << (j ? ", " : "") << json_string(titles[j]);
+                std::cout << "]}";
+            }
+            std::cout << "]" << std::endl;
+        }
+        catch (std::exception& exception)
+        {
+            std::cerr << exception.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    if (extension_paths.empty())
+        extension_paths = split_paths(std::getenv("DOCVIEW_EXTENSION_PATH"));
+    if (documentation_paths.empty())
+        documentation_paths = split_paths(std::getenv("DOCVIEW_DOCUMENTATION_PATH"));
+
+    // Load every file in extension search paths, like Docview does, files which aren't extensions are skipped
+    for (auto& path : extension_paths)
+    {
+        if (!std::filesystem::is_directory(path))
+            continue;
+        for (auto& file : std::filesystem::directory_iterator(path))
+            if (std::filesystem::is_regular_file(file.path()))
+            {
+                try
+                {
+                    docview::load_ext(std::filesystem::absolute(file.path()));
+                }
+                catch (std::runtime_error&)
+                {
+                }
+            }
+    }
+
+    // Find documents, dump-tree, get and within parse only the files they are given
+    auto scan_begin = std::chrono::steady_clock::now();
+    std::vector<std::filesystem::path> files;
+    if (command == "dump-tree" && !arguments.empty())
+        files.assign(arguments.begin(), arguments.end());
+    else if (command == "get" || command == "within")
+    {
+        if (arguments.size() < (command == "within" ? 2 : 1))
+        {
+            std::cerr << usage;
+            return 1;
+        }
+        files.push_back(arguments[0]);
+    }
+    else
+        for (auto& path : documentation_paths)
+        {
+            auto found = docview::find_documents(path, depth);
+            files.insert(files.end(), found.begin(), found.end());
+        }
+    double scan_seconds = seconds_since(scan_begin);
+
+    // Parse them all at once
+    auto parse_begin = std::chrono::steady_clock::now();
+    std::vector<const docview::doc_tree_node*> roots = docview::get_doc_trees(files);
+    double parse_seconds = seconds_since(parse_begin);
+    std::map<const docview::doc_tree_node*, std::filesystem::path> root_files;
+    for (unsigned long i = 0; i < files.size(); i++)
+        if (roots[i])
+            root_files[roots[i]] = files[i];
+
+    if (command == "search" || command == "lookup" || command == "contains" || command == "fuzzy" ||
+        command == "regex" || command == "path" || command == "within")
+    {
+        if (arguments.empty())
+        {
+            std::cerr << usage;
+            return 1;
+        }
+
+        // Scope of within is reached from root of FILE by following TITLEs, the last argument is the query
+        const docview::doc_tree_node* scope = command == "within" ? roots[0] : nullptr;
+        if (command == "within")
+        {
+            if (!scope)
+            {
+                std::cerr << "No extension could parse " << arguments[0] << std::endl;
+                return 1;
+            }
+            for (unsigned long i = 1; i + 1 < arguments.size(); i++)
+            {
+                auto child = std::find_if(scope->children.begin(), scope->children.end(),
+                    [&](const docview::doc_tree_node* child) -> bool { return child->title == arguments[i]; }
+                );
+                if (child == scope->children.end())
+                {
+                    std::cerr << "No child titled " << arguments[i] << " under " << scope->title << std::endl;
+                    return 1;
+                }
+                scope = *child;
+            }
+            arguments.assign(1, arguments.back());
+        }
+
+        // The second argument is DISTANCE for fuzzy, LIMIT for others
+        unsigned long limit = 0;
+        unsigned long distance = 1;
+        if (arguments.size() > 1 && !parse_number(arguments[1], command == "fuzzy" ? distance : limit))
+        {
+            std::cerr << "Invalid " << (command == "fuzzy" ? "distance: " : "limit: ") << arguments[1] << "\n"
+                << usage;
+            return 1;
+        }
+        auto results = command == "search" ? docview::search(arguments[0]) :
+            command == "lookup" ? docview::lookup(arguments[0]) :
+            command == "contains" ? docview::search_substring(arguments[0]) :
+            command == "fuzzy" ? docview::search_fuzzy(arguments[0], distance) :
+            command == "path" ? docview::search_path(arguments[0]) :
+            command == "within" ? docview::search_within(scope, arguments[0]) :
+            std::vector<const docview::doc_tree_node*>();
+        if (command == "regex")
+        {
+            try
+            {
+                results = docview::search_regex(arguments[0]);
+            }
+            catch (std::invalid_argument& exception)
+            {
+                std::cerr << exception.what() << std::endl;
+                return 1;
+            }
+        }
+        if (limit && results.size() > limit)
+            results.resize(limit);
+
+        std::cout << "[";
+        for (unsigned long i = 0; i < results.size(); i++)
+        {
+            const docview::doc_tree_node* root = results[i];
+            while (root->parent)
+                root = root->parent;
+            std::cout << (i ? ",\n " : "") << "{\"title\": " << json_string(results[i]->title) << ", \"path\": [";
+            auto titles = node_path(results[i]);
+            for (unsigned long j = 0; j < titles.size(); j++)
+                std::cout << (j ? ", " : "") << json_string(titles[j]);
+            std::cout << "], \"file\": " << json_string(root_files[root].string())
+                << ", \"extension\": " << json_string(docview::get_owner(results[i]).string()) << "}";
+        }
+        std::cout << "]" << std::endl;
+    }
+
+    else if (command == "dump-tree")
+    {
+        std::cout << "[";
+        bool first = true;
+        for (unsigned long i = 0; i < files.size(); i++)
+        {
+            if (!roots[i]) continue;
+            std::cout << (first ? "" : ",\n ") << "{\"file\": " << json_string(files[i].string())
+                << ", \"extension\": " << json_string(docview::get_owner(roots[i]).string())
+                << ", \"tree\": " << node_json(roots[i], true) << "}";
+            first = false;
+        }
+        std::cout << "]" << std::endl;
+    }
+
+    else if (command == "get")
+    {
+        const docview::doc_tree_node* node = roots[0];
+        if (!node)
+        {
+            std::cerr << "No extension could parse " << arguments[0] << std::endl;
+            return 1;
+        }
+
+        // Follow the titles down the tree
+        for (unsigned long i = 1; i < arguments.size(); i++)
+        {
+            auto child = std::find_if(node->children.begin(), node->children.end(),
+                [&](const docview::doc_tree_node* child) -> bool { return child->title == arguments[i]; }
+            );
+            if (child == node->children.end())
+            {
+                std::cerr << "No child titled " << arguments[i] << " under " << node->title << std::endl;
+                return 1;
+            }
+            node = *child;
+        }
+
+        auto document = docview::get_doc(node);
+        std::cout << "{\"node\": " << node_json(node, false)
+            << ", \"is_uri\": " << (document.second ? "true" : "false")
+            << ", \"content\": " << json_string(document.first)
+            << ", \"brief\": " << json_string(docview::brief(node)) << "}" << std::endl;
+    }
+
+    else if (command == "index")
+    {
+        docview::statistics stats = docview::stats();
+        std::cout << std::fixed << std::setprecision(6)
+            << "{\"files\": " << files.size()
+            << ", \"documents\": " << root_files.size()
+            << ", \"unclaimed\": " << files.size() - root_files.size()
+            << ", \"nodes\": " << stats.nodes
+            << ", \"extensions\": " << stats.loaded_extensions
+            << ", \"scan_seconds\": " << scan_seconds
+            << ", \"parse_seconds\": " << parse_seconds << "}" << std::endl;
+    }
+
+    else if (command == "publish")
+    {
+        if (arguments.empty())
+        {
+            std::cerr << usage;
+            return 1;
+        }
+        try
+        {
+            unsigned long generation = docview::publish_shared_index(arguments[0]);
+            docview::statistics stats = docview::stats();
+            std::cout << "{\"name\": " << json_string(arguments[0])
+                << ", \"generation\": " << generation
+                << ", \"nodes\": " << stats.nodes
+                << ", \"bytes\": " << stats.shared_index_bytes << "}" << std::endl;
+        }
+        catch (std::exception& exception)
+        {
+            std::cerr << exception.what() << std::endl;
+            return 1;
+        }
+    }
+
+    else if (command == "bench")
+    {
+        unsigned long query_count = 1000;
+        if (!arguments.empty() && !parse_number(arguments[0], query_count))
+        {
+            std::cerr << "Invalid number of queries: " << arguments[0] << "\n" << usage;
+            return 1;
+        }
+
+        // Collect all nodes
+        std::vector<const docview::doc_tree_node*> nodes;
+        std::vector<const docview::doc_tree_node*> stack(roots.begin(), roots.end());
+        while (!stack.empty())
+        {
+            const docview::doc_tree_node* node = stack.back();
+            stack.pop_back();
+            if (!node) continue;
+            nodes.push_back(node);
+            stack.insert(stack.end(), node->children.begin(), node->children.end());
+        }
+
+        // Queries are prefixes of titles spread over all nodes, as users type them
+        std::vector<std::string> queries;
+        for (unsigned long i = 0; i < query_count && !nodes.empty(); i++)
+        {
+            const std::string& title = nodes[i * nodes.size() / query_count % nodes.size()]->title;
+            queries.push_back(title.substr(0, std::max<std::size_t>(1, title.size() / 2)));
+        }
+
+        std::vector<double> search_latencies;
+        unsigned long matches = 0;
+        for (auto& query : queries)
+        {
+            auto begin = std::chrono::steady_clock::now();
+            matches += docview::search(query).size();
+            search_latencies.push_back(seconds_since(begin) * 1e9);
+        }
+
+        // Lookups are of whole titles, the first one includes indexing all trees
+        std::vector<double> lookup_latencies;
+        unsigned long lookup_matches = 0;
+        for (unsigned long i = 0; i < query_count && !nodes.empty(); i++)
+        {
+            const std::string& title = nodes[i * nodes.size() / query_count % nodes.size()]->title;
+            auto begin = std::chrono::steady_clock::now();
+            lookup_matches += docview::lookup(title).size();
+            lookup_latencies.push_back(seconds_since(begin) * 1e9);
+        }
+
+        // Substring queries are from middle of titles
+        std::vector<double> contains_latencies;
+        unsigned long contains_matches = 0;
+        for (unsigned long i = 0; i < query_count && !nodes.empty(); i++)
+        {
+            const std::string& title = nodes[i * nodes.size() / query_count % nodes.size()]->title;
+            std::string query = title.substr(title.size() / 3, std::max<std::size_t>(3, title.size() / 3));
+            auto begin = std::chrono::steady_clock::now();
+            contains_matches += docview::search_substring(query).size();
+            contains_latencies.push_back(seconds_since(begin) * 1e9);
+        }
+
+        // Fuzzy queries are titles with a typo, one byte replaced
+        std::vector<double> fuzzy_latencies;
+        unsigned long fuzzy_matches = 0;
+        for (unsigned long i = 0; i < query_count && !nodes.empty(); i++)
+        {
+            std::string query = nodes[i * nodes.size() / query_count % nodes.size()]->title;
+            if (!query.empty())
+                query[query.size() / 2] = query[query.size() / 2] == 'x' ? 'y' : 'x';
+            auto begin = std::chrono::steady_clock::now();
+            fuzzy_matches += docview::search_fuzzy(query, 1).size();
+            fuzzy_latencies.push_back(seconds_since(begin) * 1e9);
+        }
+
+        // Path queries are parent title and prefix of title, like "Window::set"
+        std::vector<double> path_latencies;
+        unsigned long path_matches = 0;
+        for (unsigned long i = 0; i < query_count && !nodes.empty(); i++)
+        {
+            const docview::doc_tree_node* node = nodes[i * nodes.size() / query_count % nodes.size()];
+            std::string query = node->title.substr(0, std::max<std::size_t>(1, node->title.size() / 2));
+            if (node->parent)
+                query = node->parent->title + "::" + query;
+            auto begin = std::chrono::steady_clock::now();
+            path_matches += docview::search_path(query).size();
+            path_latencies.push_back(seconds_since(begin) * 1e9);
+        }
+
+        // Scoped queries search the parent of a node for the prefix of it's title
+        std::vector<double> within_latencies;
+        unsigned long within_matches = 0;
+        for (unsigned long i = 0; i < query_count && !nodes.empty(); i++)
+        {
+            const docview::doc_tree_node* node = nodes[i * nodes.size() / query_count % nodes.size()];
+            std::string query = node->title.substr(0, std::max<std::size_t>(1, node->title.size() / 2));
+            auto begin = std::chrono::steady_clock::now();
+            within_matches += docview::search_within(node->parent ? node->parent : node, query).size();
+            within_latencies.push_back(seconds_since(begin) * 1e9);
+        }
+
+        std::vector<double> get_doc_latencies;
+        for (unsigned long i = 0; i < query_count && !nodes.empty(); i++)
+        {
+            const docview::doc_tree_node* node = nodes[i * nodes.size() / query_count % nodes.size()];
+            auto begin = std::chrono::steady_clock::now();
+            docview::get_doc(node);
+            get_doc_latencies.push_back(seconds_since(begin) * 1e9);
+        }
+
+        std::cout << std::fixed << std::setprecision(6)
+            << "{\"files\": " << files.size()
+            << ", \"documents\": " << root_files.size()
+            << ", \"nodes\": " << nodes.size()
+            << ", \"scan_seconds\": " << scan_seconds
+            << ", \"parse_seconds\": " << parse_seconds
+            << ", \"search\": " << latency_json(search_latencies)
+            << ", \"search_matches\": " << matches
+            << ", \"lookup\": " << latency_json(lookup_latencies)
+            << ", \"lookup_matches\": " << lookup_matches
+            << ", \"contains\": " << latency_json(contains_latencies)
+            << ", \"contains_matches\": " << contains_matches
+            << ", \"fuzzy\": " << latency_json(fuzzy_latencies)
+            << ", \"fuzzy_matches\": " << fuzzy_matches
+            << ", \"path\": " << latency_json(path_latencies)
+            << ", \"path_matches\": " << path_matches
+            << ", \"within\": " << latency_json(within_latencies)
+            << ", \"within_matches\": " << within_matches
+            << ", \"get_doc\": " << latency_json(get_doc_latencies) << "}" << std::endl;
+    }
+
+    else
+    {
+        std::cerr << "Unknown command: " << command << "\n" << usage;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,681 @@
+/*
+    Copyright (C) 2020 Akib Azmain
+    
+    This file is a part of Docview.
+    
+    Docview is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    Docview is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with Docview. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+    docviewd, documentation index daemon
+
+    Loads extensions and parses documentation once, then answers queries of
+    clients over a Unix domain socket, one thread per client. At most
+    max_clients clients are served at once, others are disconnected at once.
+
+    Protocol
+
+    All integers are little endian. A string is a u32 byte count followed by
+    the bytes, without terminating null. Nodes are identified by u64 ids
+    assigned by the daemon, id 0 is the virtual parent of all roots.
+
+    Request:  u32 length, u8 opcode, payload (length counts opcode and payload)
+    Response: u32 length, u8 status, payload (length counts status and payload)
+
+    Status 0 means success, status 1 means failure and the payload is an
+    error message string. Requests are answered in order.
+
+    Opcode  Request payload         Response payload
+    1       u32 limit, str query    u32 n, n * (u64 id, str title)
+    2       u64 id                  u32 n, n * (u64 id, u32 children, str title)
+    3       u64 id                  u64 parent, str title, u32 n, n * str synonym
+    4       u64 id                  u8 is_uri, str content
+    5       u64 id                  str brief
+    6       (none)                  u64 roots, u64 nodes, u64 extensions, u64 clients
+    7       u32 limit, str name     u32 n, n * (u64 id, str title)
+    8       u32 limit, str query    u32 n, n * (u64 id, str title)
+    9       u32 limit, u32 distance, str query
+                                    u32 n, n * (u64 id, str title)
+    10      u32 limit, str pattern  u32 n, n * (u64 id, str title)
+    11      u32 limit, str query    u32 n, n * (u64 id, str title)
+    12      u64 id, u32 limit, str query
+                                    u32 n, n * (u64 id, str title)
+
+    Opcode 1 searches by prefix walking every tree, a limit of 0 means no
+    limit. Opcode 2 lists children, opcode 3 describes a node, opcode 4 and 5
+    fetch document and brief. Opcodes 7 to 12 search the index of the library
+    instead of walking trees: exact name, substring, within edit distance,
+    regular expression, scoped by ancestors (e.g. "Window::set_title", a
+    query without "::" or ">" is a prefix search) and within the subtree of a
+    node, see docview::lookup and the docview::search_* functions.
+*/
+
+#include <docview.hpp>
+#include <iostream>
+#include <sstream>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <cctype>
+#include <limits>
+#include <csignal>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+
+// Usage message
+static const char* usage =
+    "Usage: docviewd [OPTION]...\n"
+    "\n"
+    "Options:\n"
+    "  -e, --extension-path DIR      load extensions from DIR, may be repeated\n"
+    "  -d, --documentation-path DIR  scan DIR for documents, may be repeated\n"
+    "      --depth N                 walk documentation paths N levels deep, 0 for\n"
+    "                                unlimited (default 1)\n"
+    "  -s, --socket PATH             listen on PATH (default\n"
+    "                                $XDG_RUNTIME_DIR/docviewd.sock)\n"
+    "\n"
+    "Without -e or -d, colon separated DOCVIEW_EXTENSION_PATH and\n"
+    "DOCVIEW_DOCUMENTATION_PATH environment variables are used.\n";
+
+// Largest request accepted, larger ones close the connection
+static const std::uint32_t max_request_size = 1 << 20;
+
+// Most clients served at once, more are disconnected
+static const unsigned long max_clients = 256;
+
+// Request opcodes
+enum opcode : std::uint8_t
+{
+    opcode_search = 1,
+    opcode_children = 2,
+    opcode_node = 3,
+    opcode_get_doc = 4,
+    opcode_brief = 5,
+    opcode_stats = 6,
+    opcode_lookup = 7,
+    opcode_search_substring = 8,
+    opcode_search_fuzzy = 9,
+    opcode_search_regex = 10,
+    opcode_search_path = 11,
+    opcode_search_within = 12
+};
+
+// Node of every id, id 0 is nullptr, standing for the parent of roots
+static std::vector<const docview::doc_tree_node*> nodes_by_id;
+
+// Id of every node
+static std::unordered_map<const docview::doc_tree_node*, std::uint64_t> ids_by_node;
+
+// Roots of all documents
+static std::vector<const docview::doc_tree_node*> roots;
+
+// Number of connected clients
+static std::atomic<unsigned long> client_count{0};
+
+// Path of the socket, removed on exit
+static std::string socket_path;
+
+/**
+ * @brief Encodes values of response payloads
+ *
+ */
+class encoder
+{
+public:
+
+    // The encoded bytes
+    std::string bytes;
+
+    void u8(std::uint8_t value)
+    {
+        bytes += (char)value;
+    }
+
+    void u32(std::uint32_t value)
+    {
+        for (int i = 0; i < 4; i++)
+            bytes += (char)(value >> (i * 8));
+    }
+
+    void u64(std::uint64_t value)
+    {
+        for (int i = 0; i < 8; i++)
+            bytes += (char)(value >> (i * 8));
+    }
+
+    void str(const std::string& value)
+    {
+        u32(value.size());
+        bytes += value;
+    }
+};
+
+/**
+ * @brief Decodes values of request payloads, throws on truncated input
+ *
+ */
+class decoder
+{
+private:
+
+    // The bytes and position of next value
+    const std::string& bytes;
+    std::size_t position;
+
+    // Makes sure given number of bytes are left
+    void need(std::size_t size)
+    {
+        if (bytes.size() - position < size)
+            throw std::invalid_argument("truncated request");
+    }
+
+public:
+
+    decoder(const std::string& bytes, std::size_t position)
+        : bytes(bytes),
+        position(position)
+    {
+    }
+
+    std::uint32_t u32()
+    {
+        need(4);
+        std::uint32_t value = 0;
+        for (int i = 0; i < 4; i++)
+            value |= (std::uint32_t)(unsigned char)bytes[position++] << (i * 8);
+        return value;
+    }
+
+    std::uint64_t u64()
+    {
+        need(8);
+        std::uint64_t value = 0;
+        for (int i = 0; i < 8; i++)
+            value |= (std::uint64_t)(unsigned char)bytes[position++] << (i * 8);
+        return value;
+    }
+
+    std::string str()
+    {
+        std::uint32_t size = u32();
+        need(size);
+        position += size;
+        return bytes.substr(position - size, size);
+    }
+};
+
+/**
+ * @brief Reads exactly given number of bytes
+ *
+ * @return false on end of file or error
+ */
+bool read_full(int fd, char* buffer, std::size_t size)
+{
+    while (size > 0)
+    {
+        ssize_t count = read(fd, buffer, size);
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count <= 0)
+            return false;
+        buffer += count;
+        size -= count;
+    }
+    return true;
+}
+
+/**
+ * @brief Writes all given bytes
+ *
+ * @return false on error
+ */
+bool write_full(int fd, const char* buffer, std::size_t size)
+{
+    while (size > 0)
+    {
+        ssize_t count = send(fd, buffer, size, MSG_NOSIGNAL);
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count <= 0)
+            return false;
+        buffer += count;
+        size -= count;
+    }
+    return true;
+}
+
+/**
+ * @brief Returns the node with given id, throws if there is none
+ *
+ */
+const docview::doc_tree_node* node_by_id(std::uint64_t id)
+{
+    if (id == 0 || id >= nodes_by_id.size())
+        throw std::invalid_argument("invalid node id");
+    return nodes_by_id[id];
+}
+
+/**
+ * @brief Writes search results, at most limit of them
+ *
+ * @param response encoder to write the results to
+ * @param results the found nodes
+ * @param limit maximum number of results, 0 for no limit
+ */
+void encode_results(encoder& response, std::vector<const docview::doc_tree_node*> results, std::uint32_t limit)
+{
+    if (limit && results.size() > limit)
+        results.resize(limit);
+    response.u32(results.size());
+    for (auto node : results)
+    {
+        response.u64(ids_by_node.at(node));
+        response.str(node->title);
+    }
+}
+
+/**
+ * @brief Answers a request
+ *
+ * @param request the request, starting with opcode
+ * @param response encoder to write the payload of response to
+ */
+void answer(const std::string& request, encoder& response)
+{
+    decoder payload(request, 1);
+    switch ((std::uint8_t)request[0])
+    {
+    case opcode_search:
+    {
+        std::uint32_t limit = payload.u32();
+        encode_results(response, docview::search(payload.str()), limit);
+        break;
+    }
+    case opcode_children:
+    {
+        std::uint64_t id = payload.u64();
+        const std::vector<const docview::doc_tree_node*>& children = id ? node_by_id(id)->children : roots;
+        response.u32(children.size());
+        for (auto child : children)
+        {
+            response.u64(ids_by_node.at(child));
+            response.u32(child->children.size());
+            response.str(child->title);
+        }
+        break;
+    }
+    case opcode_node:
+    {
+        const docview::doc_tree_node* node = node_by_id(payload.u64());
+        response.u64(node->parent ? ids_by_node.at(node->parent) : 0);
+        response.str(node->title);
+        response.u32(node->synonyms.size());
+        for (auto& synonym : node->synonyms)
+            response.str(synonym);
+        break;
+    }
+    case opcode_get_doc:
+    {
+        auto document = docview::get_doc(node_by_id(payload.u64()));
+        response.u8(document.second);
+        response.str(document.first);
+        break;
+    }
+    case opcode_brief:
+        response.str(docview::brief(node_by_id(payload.u64())));
+        break;
+    case opcode_stats:
+    {
+        docview::statistics stats = docview::stats();
+        response.u64(stats.roots);
+        response.u64(stats.nodes);
+        response.u64(stats.loaded_extensions);
+        response.u64(client_count);
+        break;
+    }
+    case opcode_lookup:
+    {
+        std::uint32_t limit = payload.u32();
+        encode_results(response, docview::lookup(payload.str()), limit);
+        break;
+    }
+    case opcode_search_substring:
+    {
+        std::uint32_t limit = payload.u32();
+        encode_results(response, docview::search_substring(payload.str()), limit);
+        break;
+    }
+    case opcode_search_fuzzy:
+    {
+        std::uint32_t limit = payload.u32();
+        std::uint32_t distance = payload.u32();
+        encode_results(response, docview::search_fuzzy(payload.str(), distance), limit);
+        break;
+    }
+    case opcode_search_regex:
+    {
+        std::uint32_t limit = payload.u32();
+        encode_results(response, docview::search_regex(payload.str()), limit);
+        break;
+    }
+    case opcode_search_path:
+    {
+        std::uint32_t limit = payload.u32();
+        encode_results(response, docview::search_path(payload.str()), limit);
+        break;
+    }
+    case opcode_search_within:
+    {
+        const docview::doc_tree_node* node = node_by_id(payload.u64());
+        std::uint32_t limit = payload.u32();
+        encode_results(response, docview::search_within(node, payload.str()), limit);
+        break;
+    }
+    default:
+        throw std::invalid_argument("unknown opcode");
+    }
+}
+
+/**
+ * @brief Serves a client until it disconnects, then uncounts it
+ *
+ * @param fd socket of client, counted in client_count by the caller
+ */
+void serve(int fd)
+{
+    std::string request;
+    while (true)
+    {
+
+        // Read the request
+        char header[4];
+        if (!read_full(fd, header, 4))
+            break;
+        std::uint32_t size = decoder(std::string(header, 4), 0).u32();
+        if (size == 0 || size > max_request_size)
+            break;
+        request.resize(size);
+        if (!read_full(fd, request.data(), size))
+            break;
+
+        // Answer it, failures are reported to the client
+        encoder response;
+        response.u8(0);
+        try
+        {
+            answer(request, response);
+        }
+        catch (std::exception& exception)
+        {
+            response.bytes.clear();
+            response.u8(1);
+            response.str(exception.what());
+        }
+
+        encoder frame;
+        frame.u32(response.bytes.size());
+        if (!write_full(fd, frame.bytes.data(), 4)
+            || !write_full(fd, response.bytes.data(), response.bytes.size()))
+            break;
+    }
+    close(fd);
+    client_count--;
+}
+
+/**
+ * @brief Splits a colon separated list of paths
+ *
+ * @param list the list, may be nullptr
+ * @return the paths
+ */
+std::vector<std::filesystem::path> split_paths(const char* list)
+{
+    std::vector<std::filesystem::path> paths;
+    std::string path;
+    std::stringstream stream(list ? list : "");
+    while (std::getline(stream, path, ':'))
+        if (!path.empty())
+            paths.push_back(path);
+    return paths;
+}
+
+/**
+ * @brief Parses a non-negative decimal number given by the user
+ *
+ * @param text the text to parse
+ * @param number where to store the number
+ * @return true on success, false if text isn't a number or is out of range
+ */
+bool parse_number(const std::string& text, unsigned long& number)
+{
+    if (text.empty() || !std::isdigit((unsigned char)text[0]))
+        return false;
+    char* end;
+    errno = 0;
+    number = std::strtoul(text.c_str(), &end, 10);
+    return *end == '\0' && errno == 0;
+}
+
+/**
+ * @brief Checks whether a daemon is answering on the socket
+ *
+ * @param address address of the socket
+ * @return true if a connection could be made
+ */
+bool is_socket_served(const sockaddr_un& address)
+{
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return false;
+    bool served = connect(fd, (const sockaddr*)&address, sizeof(address)) == 0;
+    close(fd);
+    return served;
+}
+
+/**
+ * @brief Removes the socket and exits, called on SIGINT and SIGTERM
+ *
+ */
+extern "C" void on_terminate(int)
+{
+    unlink(socket_path.c_str());
+    _exit(0);
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::filesystem::path> extension_paths;
+    std::vector<std::filesystem::path> documentation_paths;
+    unsigned int depth = 1;
+
+    // Parse options
+    for (int i = 1; i < argc; i++)
+    {
+        std::string option = argv[i];
+        if (option == "-h" || option == "--help")
+        {
+            std::cout << usage;
+            return 0;
+        }
+        if (i + 1 >= argc)
+        {
+            std::cerr << usage;
+            return 1;
+        }
+        if (option == "-e" || option == "--extension-path")
+            extension_paths.push_back(argv[++i]);
+        else if (option == "-d" || option == "--documentation-path")
+            documentation_paths.push_back(argv[++i]);
+        else if (option == "--depth")
+        {
+            unsigned long number;
+            if (!parse_number(argv[++i], number) || number > std::numeric_limits<unsigned int>::max())
+            {
+                std::cerr << "Invalid depth: " << argv[i] << "\n" << usage;
+                return 1;
+            }
+            depth = number;
+        }
+        else if (option == "-s" || option == "--socket")
+            socket_path = argv[++i];
+        else
+        {
+            std::cerr << "Unknown option: " << option << "\n" << usage;
+            return 1;
+        }
+    }
+    if (extension_paths.empty())
+        extension_paths = split_paths(std::getenv("DOCVIEW_EXTENSION_PATH"));
+    if (documentation_paths.empty())
+        documentation_paths = split_paths(std::getenv("DOCVIEW_DOCUMENTATION_PATH"));
+    if (socket_path.empty())
+    {
+        const char* runtime_directory = std::getenv("XDG_RUNTIME_DIR");
+        socket_path = runtime_directory && *runtime_directory
+            ? std::string(runtime_directory) + "/docviewd.sock"
+            : "/tmp/docviewd-" + std::to_string(getuid()) + ".sock";
+    }
+
+    // Load every file in extension search paths, files which aren't extensions are skipped
+    for (auto& path : extension_paths)
+    {
+        if (!std::filesystem::is_directory(path))
+            continue;
+        for (auto& file : std::filesystem::directory_iterator(path))
+            if (std::filesystem::is_regular_file(file.path()))
+            {
+                try
+                {
+                    docview::load_ext(std::filesystem::absolute(file.path()));
+                }
+                catch (std::runtime_error&)
+                {
+                }
+            }
+    }
+
+    // Parse all documents, they stay resident till exit
+    std::vector<std::filesystem::path> files;
+    for (auto& path : documentation_paths)
+    {
+        auto found = docview::find_documents(path, depth);
+        files.insert(files.end(), found.begin(), found.end());
+    }
+    for (auto root : docview::get_doc_trees(files))
+        if (root)
+            roots.push_back(root);
+
+    // Assign ids to all nodes, clients never see pointers
+    nodes_by_id.push_back(nullptr);
+    std::vector<const docview::doc_tree_node*> stack(roots.rbegin(), roots.rend());
+    while (!stack.empty())
+    {
+        const docview::doc_tree_node* node = stack.back();
+        stack.pop_back();
+        ids_by_node[node] = nodes_by_id.size();
+        nodes_by_id.push_back(node);
+        stack.insert(stack.end(), node->children.rbegin(), node->children.rend());
+    }
+
+    // Listen on the socket, accessible only by the user
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(address.sun_path))
+    {
+        std::cerr << "Socket path too long: " << socket_path << std::endl;
+        return 1;
+    }
+    std::strcpy(address.sun_path, socket_path.c_str());
+
+    // Remove a stale socket of a daemon which didn't exit cleanly, but never
+    // one which is still served or a file which isn't a socket
+    struct stat status;
+    if (lstat(socket_path.c_str(), &status) == 0)
+    {
+        if (!S_ISSOCK(status.st_mode))
+        {
+            std::cerr << "Not a socket, refusing to replace: " << socket_path << std::endl;
+            return 1;
+        }
+        if (is_socket_served(address))
+        {
+            std::cerr << "Another docviewd is serving on " << socket_path << std::endl;
+            return 1;
+        }
+        unlink(socket_path.c_str());
+    }
+
+    int listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    umask(0077);
+    if (listener < 0 || bind(listener, (sockaddr*)&address, sizeof(address)) < 0 || listen(listener, 64) < 0)
+    {
+        std::cerr << "Failed to listen on " << socket_path << ": " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+    std::signal(SIGINT, on_terminate);
+    std::signal(SIGTERM, on_terminate);
+    std::cerr << "Serving " << roots.size() << " documents (" << nodes_by_id.size() - 1 << " nodes) on "
+        << socket_path << std::endl;
+
+    // Accept clients, every client gets it's own thread as long as there
+    // are less than max_clients, a thread which can't be started only costs
+    // that client
+    while (true)
+    {
+        int client = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM)
+            {
+                std::cerr << "Failed to accept client: " << std::strerror(errno) << std::endl;
+                sleep(1);
+                continue;
+            }
+            std::cerr << "Failed to accept client: " << std::strerror(errno) << std::endl;
+            break;
+        }
+        if (client_count >= max_clients)
+        {
+            close(client);
+            continue;
+        }
+        client_count++;
+        try
+        {
+            std::thread(serve, client).detach();
+        }
+        catch (std::system_error& error)
+        {
+            std::cerr << "Failed to start thread for client: " << error.what() << std::endl;
+            close(client);
+            client_count--;
+        }
+    }
+
+    unlink(socket_path.c_str());
+    return 1;
+}
@@ -47,6 +47,10 @@
 #include <gtkmm/spinbutton.h>
 #include <webkit2/webkit2.h>
 #include <glibmm/ustring.h>
+#include <glibmm/main.h>
+#include <glibmm/dispatcher.h>
+#include <glibmm/markup.h>
+#include <giomm/applicationcommandline.h>
 #include <pango/pango-font.h>
 #include <libxml++/parsers/domparser.h>
 #include <libxml++/document.h>
@@ -63,6 +67,24 @@
 #include <fstream>
 #include <sstream>
 #include <cstdlib>
+#include <cctype>
+#include <cerrno>
+#include <limits>
+#include <chrono>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <tuple>
+#include <atomic>
+#include <deque>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <stdexcept>
+#include <cstring>
+#include <unistd.h>
+#include <fcntl.h>
 
 // This global variable will contain pointer to Gtk::Builder (managed by Glib::RefPtr)
 Gtk::Builder* builder = nullptr;
@@ -82,45 +104,245 @@ widget_type* get_widget(std::string id)
     return widget_ptr;
 }
 
+/**
+ * @brief Returns the directory where Docview stores it's data
+ * 
+ * @return path to data directory
+ */
+std::filesystem::path data_directory()
+{
+    return
+        #ifdef __linux__
+            std::filesystem::path("/home")
+        #else
+            std::filesystem::path("C:/Users")
+        #endif
+        / std::getenv("USER") /
+        #ifdef __linux__
+            std::filesystem::path(".local/share/Docview")
+        #else
+            std::filesystem::path()
+        #endif
+        ;
+}
+
+/**
+ * @brief Escapes tabs, newlines and backslashes of a sidebar snapshot field
+ * 
+ * @param field the field to escape
+ * @return escaped field
+ */
+std::string escape_snapshot_field(const std::string& field)
+{
+    std::string escaped;
+    for (char c : field)
+    {
+        switch (c)
+        {
+        case '\\': escaped += "\\\\"; break;
+        case '\t': escaped += "\\t"; break;
+        case '\n': escaped += "\\n"; break;
+        default: escaped += c;
+        }
+    }
+    return escaped;
+}
+
+/**
+ * @brief Parses a non-negative decimal number, e.g. from the configuration
+ * 
+ * @param text the text to parse
+ * @param number where to store the number
+ * @return true on success, false if text isn't a number or is out of range
+ */
+bool parse_number(const std::string& text, unsigned long& number)
+{
+    if (text.empty() || !std::isdigit((unsigned char)text[0]))
+        return false;
+    char* end;
+    errno = 0;
+    number = std::strtoul(text.c_str(), &end, 10);
+    return *end == '\0' && errno == 0;
+}
+
+/**
+ * @brief Reverses escape_snapshot_field
+ * 
+ * @param field the field to unescape
+ * @return unescaped field
+ */
+std::string unescape_snapshot_field(const std::string& field)
+{
+    std::string unescaped;
+    for (unsigned long i = 0; i < field.size(); i++)
+    {
+        if (field[i] == '\\' && i + 1 < field.size())
+        {
+            i++;
+            unescaped += field[i] == 't' ? '\t' : field[i] == 'n' ? '\n' : field[i];
+        }
+        else
+            unescaped += field[i];
+    }
+    return unescaped;
+}
+
+/**
+ * @brief Flushes a file or directory to disk, throws on failure
+ * 
+ * @param path path of the file or directory
+ */
+void sync_path(const std::filesystem::path& path)
+{
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0 || fsync(fd) != 0)
+    {
+        int error = errno;
+        if (fd >= 0)
+            close(fd);
+        throw std::runtime_error("failed to sync " + std::string(path) + ": " + std::strerror(error));
+    }
+    close(fd);
+}
+
 class configuration
 {
 private:
 
-    // The parser object
-    xmlpp::DomParser parser;
-
-    // Pointer to document object
-    xmlpp::Document* document;
+    // Values of all nodes having a value, by their path joined with '/'
+    std::unordered_map<std::string, Glib::ustring> values;
 
     // The name of configuration file
     std::string config_file;
 
+    // Set when values are changed after last write
+    bool dirty;
+
+    // Set to ask the writer thread to exit
+    bool exiting;
+
+    // Time of the last change, writing waits until changes settle down
+    std::chrono::steady_clock::time_point last_change;
+
+    // Mutex guarding all the above, and condition to wait for changes in them
+    std::mutex mutex;
+    std::condition_variable condition;
+
+    // Thread writing changes to config file
+    std::thread writer;
+
     /**
-     * @brief Returns pointer to node at given path
+     * @brief Returns the key of a node in values
      * 
-     * @param root search root
-     * @param path path of path
-     * @param create whether to create new node if does exist
-     * @return pointer to node at path
+     * @param path path of node
+     * @return path joined with '/'
      */
-    xmlpp::Node* get_node(xmlpp::Node* root, std::vector<std::string> path, bool create = false)
+    static std::string join_path(const std::vector<std::string>& path)
     {
-        if (path.size() == 0)
-            return root;
-        
-        for (auto& child : root->get_children())
+        std::string key;
+        for (auto& name : path)
         {
-            if (child->get_name() == path[0])
-                return get_node(child, std::vector<std::string>(path.begin() + 1, path.end()), create);
+            if (!key.empty())
+                key += '/';
+            key += name;
         }
+        return key;
+    }
+
+    /**
+     * @brief Stores values of a node and it's descendants in values
+     * 
+     * @param node the node
+     * @param key key of node
+     */
+    void load_node(const xmlpp::Node* node, const std::string& key)
+    {
+        auto element = dynamic_cast<const xmlpp::Element*>(node);
+        if (!element) return;
 
-        if (create)
+        if (element->get_child_text())
+            values[key] = element->get_child_text()->get_content();
+
+        for (auto& child : node->get_children())
+            load_node(child, key.empty() ? child->get_name() : key + '/' + child->get_name());
+    }
+
+    /**
+     * @brief Writes given values to config file, replacing it atomically
+     * 
+     * @param values the values to write
+     */
+    void write(const std::unordered_map<std::string, Glib::ustring>& values)
+    {
+
+        // Sort the keys, so that the file doesn't change order on every write
+        std::vector<std::string> keys;
+        for (auto& value : values)
+            keys.push_back(value.first);
+        std::sort(keys.begin(), keys.end());
+
+        // Build the document, creating every node on path of a key
+        xmlpp::Document document;
+        xmlpp::Element* root = document.create_root_node("docview");
+        for (auto& key : keys)
+        {
+            xmlpp::Element* element = root;
+            std::string name;
+            std::stringstream stream(key);
+            while (std::getline(stream, name, '/'))
+            {
+                xmlpp::Element* child = nullptr;
+                for (auto& node : element->get_children(name))
+                    if ((child = dynamic_cast<xmlpp::Element*>(node)))
+                        break;
+                element = child ? child : element->add_child(name);
+            }
+            element->set_child_text(values.at(key));
+        }
+
+        // Write to a temporary file and rename it, so that the file is never half written, the file
+        // is flushed before renaming and the directory after, so that a crash leaves the old or the
+        // new file, not an empty one
+        try
+        {
+            document.write_to_file(config_file + ".tmp");
+            sync_path(config_file + ".tmp");
+            std::filesystem::rename(config_file + ".tmp", config_file);
+            std::filesystem::path directory = std::filesystem::path(config_file).parent_path();
+            sync_path(directory.empty() ? "." : directory);
+        }
+        catch (std::exception& exception)
         {
-            auto element = root->add_child(path[0]);
-            return get_node(element, std::vector<std::string>(path.begin() + 1, path.end()), create);
+            std::cerr << "Failed to write configuration: " << exception.what() << std::endl;
         }
+    }
 
-        return nullptr;
+    /**
+     * @brief Runs in writer thread, writes changes once they settle down
+     * 
+     */
+    void write_changes()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true)
+        {
+            condition.wait(lock, [&]() -> bool { return dirty || exiting; });
+            if (exiting)
+                return;
+
+            // Wait until nothing is changed for a while
+            while (!exiting && std::chrono::steady_clock::now() - last_change < std::chrono::milliseconds(500))
+                condition.wait_until(lock, last_change + std::chrono::milliseconds(500));
+            if (exiting)
+                return;
+
+            // Write a copy, so that values can be used meanwhile
+            auto values_copy = values;
+            dirty = false;
+            lock.unlock();
+            write(values_copy);
+            lock.lock();
+        }
     }
 
 public:
@@ -130,47 +352,35 @@ public:
      * 
      */
     configuration()
-        : parser(),
-        document(nullptr),
+        : values(),
 
         // Setup config file path according to platform
-        config_file(
-            #ifdef __linux__
-                std::filesystem::path("/home")
-            #else
-                std::filesystem::path("C:/Users")
-            #endif
-            / std::getenv("USER") /
-            #ifdef __linux__
-                std::filesystem::path(".local/share/Docview")
-            #endif
-            / "docview.xml"
-        )
+        config_file(data_directory() / "docview.xml"),
+        dirty(false),
+        exiting(false)
     {
 
         // Make sure directory exists
-        if (!std::filesystem::exists(config_file))
-        {
-            std::filesystem::create_directories(config_file);
-        }
+        std::filesystem::create_directories(data_directory());
 
-        // Try to parse config file
+        // Try to parse config file, values are read once and served from memory afterwards
         try
         {
+            xmlpp::DomParser parser;
             parser.parse_file(config_file);
-            document = parser.get_document();
-            if (document->get_root_node()->get_name() != "docview") throw xmlpp::exception("");
+            auto root = parser.get_document()->get_root_node();
+            if (root->get_name() != "docview") throw xmlpp::exception("");
+            for (auto& child : root->get_children())
+                load_node(child, child->get_name());
         }
 
-        // On failure, rewrite config file
+        // On failure, start with empty configuration, the file will be rewritten on first change
         catch (xmlpp::exception&)
         {
-
-            // Clear config file content
-            std::ofstream(config_file).flush();
-            document = new xmlpp::Document;
-            document->create_root_node("docview");
+            values.clear();
         }
+
+        writer = std::thread(&configuration::write_changes, this);
     }
 
     /**
@@ -179,7 +389,16 @@ public:
      */
     ~configuration()
     {
-        document->write_to_file(config_file);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            exiting = true;
+        }
+        condition.notify_all();
+        writer.join();
+
+        // Write changes not written by writer thread yet
+        if (dirty)
+            write(values);
     }
 
     /**
@@ -190,12 +409,20 @@ public:
      */
     void set_value(std::vector<std::string> path, Glib::ustring value)
     {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            // Nothing to write if the value is same
+            auto& current = values[join_path(path)];
+            if (current == value) return;
 
-        // Get the node at given path, create if doesn't exist
-        auto element = dynamic_cast<xmlpp::Element*>(get_node(document->get_root_node(), path, true));
+            current = value;
+            dirty = true;
+            last_change = std::chrono::steady_clock::now();
+        }
 
-        // Set the value
-        element->set_child_text(value);
+        // Wake up the writer thread
+        condition.notify_all();
     }
 
     /**
@@ -206,29 +433,147 @@ public:
      */
     Glib::ustring get_value(std::vector<std::string> path)
     {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        // Return empty string if the node has no value
+        auto value = values.find(join_path(path));
+        if (value == values.end()) return Glib::ustring();
+
+        return value->second;
+    }
+};
+
+class startup_timeline
+{
+private:
+
+    // A timed phase of startup
+    struct phase
+    {
+        std::string name;
+        std::chrono::steady_clock::time_point begin;
+        std::chrono::steady_clock::time_point end;
+        unsigned long thread;
+    };
+
+    // Where to write the timeline, empty if disabled
+    std::string output;
+
+    // Time when the timeline was created, all timestamps are relative to this
+    std::chrono::steady_clock::time_point origin;
+
+    // All phases recorded till now
+    std::vector<phase> phases;
 
-        // Get the node at given path
-        auto element = dynamic_cast<xmlpp::Element*>(get_node(document->get_root_node(), path));
+    // Small numbers for threads, for readable output
+    std::map<std::thread::id, unsigned long> threads;
 
-        // Make sure element isn't nullptr, return empty string on failure
-        if (!element) return Glib::ustring();
+    // Mutex guarding all of the above, phases are recorded from several threads
+    std::mutex mutex;
 
-        // Make sure element has a text node isn't nullptr, return empty string on failure
-        if (!element->get_child_text()) return Glib::ustring();
+    // Whether the timeline is written already
+    bool written;
 
-        // Return the value
-        return element->get_child_text()->get_content();
+public:
+
+    /**
+     * @brief Constructs a new startup timeline object
+     * 
+     * @details Recording is enabled by setting environment variable
+     * DOCVIEW_STARTUP_TRACE to a file name, for a Chrome trace event JSON file,
+     * or to "-", for a summary on standard error.
+     */
+    startup_timeline()
+        : output(std::getenv("DOCVIEW_STARTUP_TRACE") ? std::getenv("DOCVIEW_STARTUP_TRACE") : ""),
+        origin(std::chrono::steady_clock::now()),
+        written(false)
+    {}
+
+    /**
+     * @brief Records a phase which began at given time and ends now
+     * 
+     * @param name name of phase
+     * @param begin time when the phase began
+     */
+    void record(std::string name, std::chrono::steady_clock::time_point begin)
+    {
+        if (output.empty()) return;
+
+        auto end = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lock(mutex);
+        if (written) return;
+        auto thread = threads.insert(std::make_pair(std::this_thread::get_id(), threads.size())).first->second;
+        phases.push_back({name, begin, end, thread});
+    }
+
+    /**
+     * @brief Writes the timeline, only the first call has effects
+     * 
+     */
+    void write()
+    {
+        if (output.empty()) return;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (written) return;
+        written = true;
+
+        auto microseconds = [](std::chrono::steady_clock::duration duration) -> long long
+        {
+            return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+        };
+
+        // Print a summary in milliseconds
+        if (output == "-")
+        {
+            for (auto& phase : phases)
+                std::cerr << "docview startup: " << phase.name
+                    << " at " << microseconds(phase.begin - origin) / 1000.0 << " ms"
+                    << " took " << microseconds(phase.end - phase.begin) / 1000.0 << " ms" << std::endl;
+            return;
+        }
+
+        // Write complete events of Chrome trace event format
+        std::ofstream trace(output);
+        trace << "{\"traceEvents\":[";
+        for (unsigned long i = 0; i < phases.size(); i++)
+        {
+            trace << (i ? "," : "") << "{\"name\":\"" << phases[i].name << "\",\"ph\":\"X\""
+                << ",\"ts\":" << microseconds(phases[i].begin - origin)
+                << ",\"dur\":" << microseconds(phases[i].end - phases[i].begin)
+                << ",\"pid\":" << getpid() << ",\"tid\":" << phases[i].thread << "}";
+        }
+        trace << "]}" << std::endl;
     }
 };
 
 int main(int argc, char** argv)
 {
 
+    // Record startup phases, if requested
+    startup_timeline timeline;
+    auto phase_begin = std::chrono::steady_clock::now();
+
+    // Create new Gtk::Application object, it handles command line so that later launches can forward theirs
+	auto app = Gtk::Application::create(argc, argv, "org.docview", Gio::APPLICATION_HANDLES_COMMAND_LINE);
+
+    // If another instance is running, let it handle our command line, before doing anything heavy
+    try
+    {
+        app->register_application();
+    }
+    catch (Glib::Error& exception)
+    {
+        std::cerr << "Failed to register application: " << exception.what() << std::endl;
+    }
+    if (app->is_remote())
+        return app->run(argc, argv);
+    timeline.record("Application creation", phase_begin);
+
     // Create the configuration object
+    phase_begin = std::chrono::steady_clock::now();
     configuration config;
-
-    // Create new Gtk::Application object
-	auto app = Gtk::Application::create(argc, argv, "org.docview");
+    timeline.record("Configuration parsing", phase_begin);
 
     // Create new Gtk::Builder object
     auto builder = Gtk::Builder::create();
@@ -237,13 +582,22 @@ int main(int argc, char** argv)
     ::builder = builder.get();
 
     // Register WebKit's WebView and Settings widget to prevent builder errors
+    phase_begin = std::chrono::steady_clock::now();
     webkit_web_view_new();
     webkit_settings_new();
 
+    // Web context shared by all webviews, so that they share it's caches, web processes are shared by relating
+    // webviews to each other, as process models are ignored since WebKitGTK 2.26
+    WebKitWebContext* web_context = webkit_web_context_new();
+    webkit_web_context_set_cache_model(web_context, WEBKIT_CACHE_MODEL_DOCUMENT_VIEWER);
+    timeline.record("WebKit initialization", phase_begin);
+
     // Builder the UI from .ui file generated by glade
+    phase_begin = std::chrono::steady_clock::now();
     try
     {
         builder->add_from_file(std::filesystem::path(ASSETS_DIR) / "window.ui");
+        timeline.record("User interface building", phase_begin);
     }
 
     // On any exception, print a error message and exit
@@ -312,6 +666,34 @@ int main(int argc, char** argv)
     // This array holds all tabs
     std::vector<Gtk::Widget*> tabs;
 
+    // Number of tabs created till now, used to give every tab an unique name
+    unsigned int tab_count = 0;
+
+    // Tab which was visible till last tab switch
+    Gtk::Widget* visible_tab = nullptr;
+
+    // Time when each tab was hidden last time
+    std::map<Gtk::Widget*, std::chrono::steady_clock::time_point> tab_last_visible;
+
+    // HTML shown by tabs whose page was loaded from a string instead of an URI
+    std::map<Gtk::Widget*, std::string> tab_html;
+
+    // URI or HTML (with whether it's an URI) and scroll position of hibernated tabs, by the placeholders
+    // standing for them
+    std::map<Gtk::Widget*, std::tuple<std::string, bool, double>> hibernated_tabs;
+
+    // Tabs asked for their scroll position to be hibernated, which haven't answered yet
+    std::set<Gtk::Widget*> hibernating_tabs;
+
+    // Webviews created and loaded in advance, to be used for new tabs
+    std::deque<Gtk::Widget*> prewarmed_webviews;
+
+    // Number of webviews to keep in prewarmed_webviews
+    const std::size_t prewarmed_webview_count = 2;
+
+    // Seconds a tab can stay hidden before it's webview is destroyed, zero to never do that
+    unsigned int tab_hibernate_after = 600;
+
     // This variable holds pointer to find controller of currently visible webview
     WebKitFindController* webview_finder = nullptr;
 
@@ -321,6 +703,89 @@ int main(int argc, char** argv)
     // Vector holding all loaded extension
     std::vector<std::filesystem::path> loaded_extensions;
 
+    // Connection to the pending search, replaced whenever the query changes
+    sigc::connection search_pending;
+
+    // Moving average of search duration, used to size the debounce window
+    std::chrono::steady_clock::duration search_latency = std::chrono::steady_clock::duration::zero();
+
+    // Thread parsing documents in background
+    std::thread scan_thread;
+
+    // Set to ask the scanning thread to stop
+    std::atomic<bool> scan_cancelled = false;
+
+    // Set by the scanning thread when it's done
+    std::atomic<bool> scan_finished = true;
+
+    // Number of files scanned and to scan, used for progress indicator
+    std::atomic<unsigned long> scan_done = 0;
+    std::atomic<unsigned long> scan_total = 0;
+
+    // Root nodes parsed by scanning thread, but not added to sidebar yet
+    std::deque<std::pair<const docview::doc_tree_node*, std::filesystem::path>> scan_results;
+
+    // Mutex guarding scan_results
+    std::mutex scan_results_mutex;
+
+    // Wakes up the main loop to take scan results
+    Glib::Dispatcher scan_dispatcher;
+
+    // Whether scan results replace existing roots of same file, instead of being appended
+    bool scan_patching = false;
+
+    // Whether the sidebar reflects all documents, false while scanning or after a cancelled scan
+    bool sidebar_complete = false;
+
+    // Files which no loaded extension could parse
+    std::vector<std::filesystem::path> unclaimed_files;
+
+    // Thread fetching documents in background, started on first request
+    std::thread doc_thread;
+
+    // Documents requested, as tab to show it, token of request and node of document
+    std::deque<std::tuple<Gtk::Widget*, unsigned long, const docview::doc_tree_node*>> doc_requests;
+
+    // Documents fetched, as tab to show it, token of request and URI or HTML of document
+    std::deque<std::tuple<Gtk::Widget*, unsigned long, std::pair<std::string, bool>>> doc_results;
+
+    // Token of the latest request of every tab, results of older requests are ignored
+    std::map<Gtk::Widget*, unsigned long> tab_doc_tokens;
+
+    // Number of documents requested till now, used to make tokens
+    unsigned long doc_request_count = 0;
+
+    // Set while the document fetching thread is calling extension
+    bool doc_busy = false;
+
+    // Set to ask the document fetching thread to exit
+    bool doc_thread_exit = false;
+
+    // Mutex guarding all the above, and condition to wait for changes in them
+    std::mutex doc_mutex;
+    std::condition_variable doc_condition;
+
+    // Wakes up the main loop to show fetched documents
+    Glib::Dispatcher doc_dispatcher;
+
+    // How deep documentation search paths are walked, zero for unlimited
+    unsigned int documentation_search_depth = 1;
+
+    // File holding the sidebar of previous session
+    std::filesystem::path sidebar_snapshot_file = data_directory() / "sidebar.snapshot";
+
+    // Whether the next scan should revalidate the sidebar restored from snapshot
+    bool snapshot_pending = false;
+
+    // Top level sidebar rows restored from snapshot but not revalidated yet, by file
+    std::map<std::filesystem::path, Gtk::TreeStore::iterator> snapshot_rows;
+
+    // Top level sidebar rows of parsed trees, by root node
+    std::map<const docview::doc_tree_node*, Gtk::TreeStore::iterator> sidebar_rows;
+
+    // Documents requested by launches, as whether it's a node path, and the query or titles on path from root
+    std::vector<std::pair<bool, std::vector<std::string>>> launch_requests;
+
     // List of all known extensions in an showable format
     Glib::RefPtr<Gtk::ListStore> extension_list_contents;
 
@@ -339,11 +804,23 @@ int main(int argc, char** argv)
     std::function<void()> on_about_button_clicked;
     std::function<void()> on_preferences_button_clicked;
     std::function<void(const Gtk::TreeModel::Path&, Gtk::TreeView::Column*)> on_sidebar_option_selected;
+    std::function<void(Gtk::Widget*, const docview::doc_tree_node*)> show_document;
+    std::function<int(const Glib::RefPtr<Gio::ApplicationCommandLine>&)> on_command_line;
+    std::function<void()> open_launch_requests;
     void(*on_webview_load_change)(WebKitWebView*, WebKitLoadEvent, void*);
+    void(*on_restored_webview_load_change)(WebKitWebView*, WebKitLoadEvent, void*);
+    void(*on_webview_scroll_position)(GObject*, GAsyncResult*, void*);
     std::function<void()> on_title_changed;
     std::function<void()> on_active_tab_changed;
     std::function<void()> on_tab_added;
     std::function<void()> on_tab_closed;
+    std::function<Gtk::Widget*(std::string)> create_webview;
+    std::function<Gtk::Widget*()> new_webview;
+    std::function<void()> prewarm_webviews;
+    std::function<void(Gtk::Widget*, Gtk::Widget*)> replace_tab;
+    std::function<bool()> on_hibernation_timer;
+    std::function<void(Gtk::Widget*, double)> hibernate_tab;
+    std::function<void(Gtk::Widget*)> restore_tab;
     std::function<void()> on_webview_refresh_button_clicked;
     std::function<void()> on_webview_find_button_clicked;
     std::function<void()> on_webview_find_bar_state_changed;
@@ -353,8 +830,22 @@ int main(int argc, char** argv)
     std::function<void()> on_history_previous;
     std::function<void()> on_history_next;
     std::function<void()> on_search_changed;
+    std::function<bool()> on_search_timeout;
     std::function<void()> on_quit_button_clicked;
     std::function<void()> on_preferences_documentation_search_path_unfocused;
+    std::function<void(
+        std::vector<std::filesystem::path>,
+        std::vector<std::filesystem::path>,
+        std::filesystem::path
+    )> start_scan;
+    std::function<void()> on_scan_progress;
+    std::function<void()> cancel_scan;
+    std::function<void()> fetch_documents;
+    std::function<void()> on_doc_fetched;
+    std::function<void()> cancel_doc_fetches;
+    std::function<void()> restore_sidebar_snapshot;
+    std::function<void()> save_sidebar_snapshot;
+    std::function<void(const docview::doc_tree_node*, Gtk::TreeStore::iterator)> patch_tree;
     std::function<void()> on_preferences_use_system_fonts_changed;
     std::function<void()> on_preferences_default_font_changed;
     std::function<void()> on_preferences_monospace_font_changed;
@@ -433,16 +924,229 @@ int main(int argc, char** argv)
             // Dereference the iterator
             Gtk::TreeModel::Row row = *it;
 
-            webkit_web_view_load_uri(WEBKIT_WEB_VIEW(stack->get_visible_child()->gobj()),
-                docview::get_doc(row[sidebar_column_node]).first.c_str()
-            );
+            // Rows restored from snapshot have no node until revalidated
+            if (!row[sidebar_column_node]) return;
+
+            show_document(stack->get_visible_child(), row[sidebar_column_node]);
+        }
+    };
+
+    // Lambda function to show the document of a node in a tab
+    show_document = [&](Gtk::Widget* tab, const docview::doc_tree_node* node) -> void
+    {
+
+        // Extensions might be slow, so ask the document fetching thread to get the document
+        {
+            std::lock_guard<std::mutex> lock(doc_mutex);
+            tab_doc_tokens[tab] = ++doc_request_count;
+            doc_requests.emplace_back(tab, doc_request_count, node);
+        }
+        doc_condition.notify_all();
+        if (!doc_thread.joinable())
+            doc_thread = std::thread(fetch_documents);
+
+        // Show that the tab is loading till the document arrives
+        stack->child_property_title(*tab) = "Loading";
+    };
+
+    // Lambda function to call on command line of every launch, later launches forward theirs to this instance
+    on_command_line = [&](const Glib::RefPtr<Gio::ApplicationCommandLine>& command_line) -> int
+    {
+        int argument_count;
+        char** argument_array = command_line->get_arguments(argument_count);
+        std::vector<std::string> arguments(argument_array + std::min(argument_count, 1), argument_array + argument_count);
+        g_strfreev(argument_array);
+
+        // Arguments are either a search query, or --node followed by titles on path from root to the node
+        if (!arguments.empty() && arguments[0] == "--node")
+        {
+            if (arguments.size() > 1)
+                launch_requests.emplace_back(true, std::vector<std::string>(arguments.begin() + 1, arguments.end()));
         }
+        else if (!arguments.empty())
+        {
+            std::string query = arguments[0];
+            for (unsigned long i = 1; i < arguments.size(); i++)
+                query += " " + arguments[i];
+            launch_requests.emplace_back(false, std::vector<std::string>{query});
+        }
+
+        // Show the window, or bring it to front if it's already shown
+        app->activate();
+        window->present();
+
+        open_launch_requests();
+        return 0;
+    };
+
+    // Lambda function to open documents requested by launches, each in a new tab
+    open_launch_requests = [&]() -> void
+    {
+        for (unsigned long i = 0; i < launch_requests.size(); i++)
+        {
+            auto& [node_path, words] = launch_requests[i];
+
+            // Follow children with given titles starting from roots, or take the first search result
+            const docview::doc_tree_node* node = nullptr;
+            if (node_path)
+            {
+                std::vector<const docview::doc_tree_node*> candidates;
+                for (auto& root_node : document_root_nodes)
+                    candidates.push_back(root_node.first);
+                for (auto& title : words)
+                {
+                    auto next = std::find_if(candidates.begin(), candidates.end(),
+                        [&](const docview::doc_tree_node* candidate) { return candidate->title == title; }
+                    );
+                    if (next == candidates.end())
+                    {
+                        node = nullptr;
+                        break;
+                    }
+                    node = *next;
+                    candidates = node->children;
+                }
+            }
+            else if (sidebar_complete)
+            {
+
+                // Prefer a node named exactly like the query, otherwise search the index by prefix, queries
+                // like "Window::set_title" are scoped by ancestors
+                std::set<const docview::doc_tree_node*> roots;
+                for (auto& root_node : document_root_nodes)
+                    roots.insert(root_node.first);
+                auto is_shown = [&](const docview::doc_tree_node* match) -> bool
+                {
+                    while (match->parent)
+                        match = match->parent;
+                    return roots.count(match);
+                };
+                for (auto& matches : {docview::lookup(words[0]), docview::search_path(words[0])})
+                {
+                    auto match = std::find_if(matches.begin(), matches.end(), is_shown);
+                    if (match != matches.end())
+                    {
+                        node = *match;
+                        break;
+                    }
+                }
+            }
+
+            // The document might not be parsed yet, so try again after scanning is done
+            if (!node && !sidebar_complete)
+                continue;
+
+            on_tab_added();
+            Gtk::Widget* tab = stack->get_visible_child();
+            if (node)
+                show_document(tab, node);
+            else
+            {
+                std::string path = words[0];
+                for (unsigned long j = 1; j < words.size(); j++)
+                    path += " > " + words[j];
+                tab_html[tab] = "<p>No document found for " + Glib::Markup::escape_text(path) + "</p>";
+                webkit_web_view_load_html(WEBKIT_WEB_VIEW(tab->gobj()), tab_html[tab].c_str(), "file:///");
+            }
+
+            // Show other results of the query in sidebar
+            if (!node_path)
+                search_entry->set_text(words[0]);
+
+            launch_requests.erase(launch_requests.begin() + i--);
+        }
+    };
+
+    // Lambda function to run in document fetching thread
+    fetch_documents = [&]() -> void
+    {
+        std::unique_lock<std::mutex> lock(doc_mutex);
+        while (true)
+        {
+            doc_condition.wait(lock, [&]() -> bool { return doc_thread_exit || !doc_requests.empty(); });
+            if (doc_thread_exit)
+                return;
+
+            auto [tab, token, node] = doc_requests.front();
+            doc_requests.pop_front();
+
+            // Skip the request if the user has requested another document in the tab meanwhile
+            auto latest = tab_doc_tokens.find(tab);
+            if (latest == tab_doc_tokens.end() || latest->second != token)
+                continue;
+
+            // Get the document without holding the lock, show the error in place of it on failure
+            doc_busy = true;
+            lock.unlock();
+            std::pair<std::string, bool> doc;
+            try
+            {
+                doc = docview::get_doc(node);
+            }
+            catch (std::exception& exception)
+            {
+                doc = std::make_pair(
+                    "<p>Failed to get the document: " + Glib::Markup::escape_text(exception.what()) + "</p>",
+                    false
+                );
+            }
+            lock.lock();
+            doc_busy = false;
+
+            doc_results.emplace_back(tab, token, doc);
+            doc_condition.notify_all();
+            doc_dispatcher.emit();
+        }
+    };
+
+    // Lambda function to call when documents are fetched
+    on_doc_fetched = [&]() -> void
+    {
+        std::deque<std::tuple<Gtk::Widget*, unsigned long, std::pair<std::string, bool>>> results;
+        std::map<Gtk::Widget*, unsigned long> tokens;
+        {
+            std::lock_guard<std::mutex> lock(doc_mutex);
+            results.swap(doc_results);
+            tokens = tab_doc_tokens;
+        }
+
+        for (auto& [tab, token, doc] : results)
+        {
+
+            // Ignore stale results, and results for tabs closed or hibernated meanwhile
+            if (tokens[tab] != token || std::find(tabs.begin(), tabs.end(), tab) == tabs.end())
+                continue;
+
+            if (doc.second)
+            {
+                tab_html.erase(tab);
+                webkit_web_view_load_uri(WEBKIT_WEB_VIEW(tab->gobj()), doc.first.c_str());
+            }
+            else
+            {
+                tab_html[tab] = doc.first;
+                webkit_web_view_load_html(WEBKIT_WEB_VIEW(tab->gobj()), doc.first.c_str(), "file:///");
+            }
+        }
+    };
+
+    // Lambda function to drop pending document requests, and wait for the one being fetched
+    cancel_doc_fetches = [&]() -> void
+    {
+        std::unique_lock<std::mutex> lock(doc_mutex);
+        doc_requests.clear();
+        doc_condition.wait(lock, [&]() -> bool { return !doc_busy; });
+        doc_results.clear();
     };
 
     // Lambda function to call on webview load change
     on_webview_load_change = [](WebKitWebView* webview, WebKitLoadEvent event, void*) -> void
     {
 
+        // Prewarmed webviews aren't in the stack yet, they have no title
+        if (!gtk_widget_get_parent(GTK_WIDGET(webview)))
+            return;
+
         // Title property of webview
         auto title = ((Gtk::Stack*)Glib::wrap(GTK_WIDGET(webview))->get_parent())->child_property_title(
             *Glib::wrap(GTK_WIDGET(webview))
@@ -479,10 +1183,67 @@ int main(int argc, char** argv)
         );
     };
 
+    // Lambda function to call on webview restored from hibernation load change
+    on_restored_webview_load_change = [](WebKitWebView* webview, WebKitLoadEvent event, void* scroll) -> void
+    {
+
+        // Scroll to where the user was before hibernation, once the page is loaded
+        if (event == WEBKIT_LOAD_FINISHED)
+        {
+            webkit_web_view_run_javascript(webview,
+                ("window.scrollTo(0, " + std::to_string((long)*(double*)scroll) + ")").c_str(),
+                nullptr, nullptr, nullptr
+            );
+
+            // This frees scroll too, so do it last
+            g_signal_handlers_disconnect_by_data(webview, scroll);
+        }
+    };
+
+    // Lambda function to call when a webview reports it's scroll position
+    on_webview_scroll_position = [](GObject* webview, GAsyncResult* result, void* data) -> void
+    {
+        auto request = (std::pair<std::function<void(Gtk::Widget*, double)>*, std::vector<Gtk::Widget*>*>*)data;
+
+        // Get the scroll position, assume top of page on failure
+        double scroll = 0;
+        WebKitJavascriptResult* js_result =
+            webkit_web_view_run_javascript_finish(WEBKIT_WEB_VIEW(webview), result, nullptr);
+        if (js_result)
+        {
+            scroll = jsc_value_to_double(webkit_javascript_result_get_js_value(js_result));
+            webkit_javascript_result_unref(js_result);
+        }
+
+        // Pass it to the requester, unless the tab was closed meanwhile
+        auto tab = std::find_if(request->second->begin(), request->second->end(),
+            [&](Gtk::Widget* tab) -> bool { return (GObject*)tab->gobj() == webview; }
+        );
+        if (tab != request->second->end())
+            (*request->first)(*tab, scroll);
+        delete request;
+    };
+
     // Lambda function to call on active tab change
     on_active_tab_changed = [&]() -> void
     {
 
+        // The tab being shown, might be nullptr while closing tabs
+        Gtk::Widget* tab = stack->get_visible_child();
+        if (!tab) return;
+
+        // If it's hibernated, restore it, restoring shows the new webview, which calls this again
+        if (hibernated_tabs.count(tab))
+        {
+            restore_tab(tab);
+            return;
+        }
+
+        // Remember when the previous tab was hidden
+        if (visible_tab && visible_tab != tab)
+            tab_last_visible[visible_tab] = std::chrono::steady_clock::now();
+        visible_tab = tab;
+
         // The active tab is changed, so title should be changed
         on_title_changed();
 
@@ -494,28 +1255,17 @@ int main(int argc, char** argv)
     on_tab_added = [&]() -> void
     {
 
-        // Tab number, automatically initialized with zero
-        static unsigned int tab_num;
-
-        // Increment tab_num, as 0 is already used by initial tab
-        tab_num++;
-
         // Create and configure new webview
-        Gtk::Widget* webview = Glib::wrap(webkit_web_view_new());
-        webkit_web_view_set_settings(
-            WEBKIT_WEB_VIEW(webview->gobj()),
-            WEBKIT_SETTINGS(webview_settings)
-        );
-        webkit_web_view_load_uri(
-            WEBKIT_WEB_VIEW(webview->gobj()),
-            (std::string("file://") + ASSETS_DIR + "/welcome.html").c_str()
-        );
-        g_signal_connect(webview->gobj(), "load-changed",
-            G_CALLBACK(on_webview_load_change), nullptr);
+        Gtk::Widget* webview = create_webview(std::string("file://") + ASSETS_DIR + "/welcome.html");
 
-        // Create new tab, present it to user
-        stack->add(*webview, std::to_string(tab_num), "Empty Page");
+        // Create new tab, present it to user, the stack keeps it alive from now
+        stack->add(*webview, std::to_string(++tab_count), "Empty Page");
+        g_object_unref(webview->gobj());
         webview->show();
+
+        // A prewarmed webview might have finished loading already
+        if (!webkit_web_view_is_loading(WEBKIT_WEB_VIEW(webview->gobj())))
+            on_webview_load_change(WEBKIT_WEB_VIEW(webview->gobj()), WEBKIT_LOAD_FINISHED, nullptr);
         stack->set_visible_child(*webview);
 
         // Show tab_switcher in title and show changes
@@ -546,6 +1296,18 @@ int main(int argc, char** argv)
         // The tab to close
         Gtk::Widget* tab_to_close = stack->get_visible_child();
 
+        // Forget everything about it
+        if (visible_tab == tab_to_close)
+            visible_tab = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(doc_mutex);
+            tab_doc_tokens.erase(tab_to_close);
+        }
+        tab_last_visible.erase(tab_to_close);
+        tab_html.erase(tab_to_close);
+        hibernated_tabs.erase(tab_to_close);
+        hibernating_tabs.erase(tab_to_close);
+
         // Move all widgets to the new stack
         for (unsigned long i = 0; i < tabs.size(); i++)
         {
@@ -568,6 +1330,193 @@ int main(int argc, char** argv)
         window->show_all_children();
     };
 
+    // Lambda function to create a new webview showing given URI, caller must unref it once it's in a container
+    create_webview = [&](std::string uri) -> Gtk::Widget*
+    {
+        Gtk::Widget* webview;
+
+        // Use a prewarmed webview if available, it's already showing the welcome page
+        if (!prewarmed_webviews.empty())
+        {
+            webview = prewarmed_webviews.front();
+            prewarmed_webviews.pop_front();
+            if (uri != std::string("file://") + ASSETS_DIR + "/welcome.html")
+                webkit_web_view_load_uri(WEBKIT_WEB_VIEW(webview->gobj()), uri.c_str());
+        }
+
+        // Otherwise create a new one
+        else
+        {
+            webview = new_webview();
+            webkit_web_view_load_uri(WEBKIT_WEB_VIEW(webview->gobj()), uri.c_str());
+        }
+
+        // Refill the pool when the user interface is idle
+        Glib::signal_idle().connect_once(sigc::mem_fun(
+            prewarm_webviews, &std::function<void()>::operator()
+        ));
+
+        return webview;
+    };
+
+    // Lambda function to create an empty webview, holding a reference to keep it alive while it's not in any container
+    new_webview = [&]() -> Gtk::Widget*
+    {
+
+        // Relate it to an existing webview, so that it runs in the same web process
+        WebKitWebView* related = nullptr;
+        if (!prewarmed_webviews.empty())
+            related = WEBKIT_WEB_VIEW(prewarmed_webviews.front()->gobj());
+        else
+            for (auto tab : tabs)
+                if (!hibernated_tabs.count(tab))
+                {
+                    related = WEBKIT_WEB_VIEW(tab->gobj());
+                    break;
+                }
+
+        Gtk::Widget* webview = Glib::wrap(
+            related ? webkit_web_view_new_with_related_view(related) : webkit_web_view_new_with_context(web_context)
+        );
+        webkit_web_view_set_settings(
+            WEBKIT_WEB_VIEW(webview->gobj()),
+            WEBKIT_SETTINGS(webview_settings)
+        );
+        g_signal_connect(webview->gobj(), "load-changed",
+            G_CALLBACK(on_webview_load_change), nullptr);
+        g_object_ref_sink(webview->gobj());
+        return webview;
+    };
+
+    // Lambda function to fill prewarmed_webviews
+    prewarm_webviews = [&]() -> void
+    {
+        while (prewarmed_webviews.size() < prewarmed_webview_count)
+        {
+            Gtk::Widget* webview = new_webview();
+            webkit_web_view_load_uri(
+                WEBKIT_WEB_VIEW(webview->gobj()),
+                (std::string("file://") + ASSETS_DIR + "/welcome.html").c_str()
+            );
+            prewarmed_webviews.push_back(webview);
+        }
+    };
+
+    // Lambda function to put a widget in place of a tab, destroying the old one
+    replace_tab = [&](Gtk::Widget* old_tab, Gtk::Widget* new_tab) -> void
+    {
+
+        // Add the new widget at the same position with same title, names must be unique
+        Glib::ustring tab_title = stack->child_property_title(*old_tab);
+        int position = stack->child_property_position(*old_tab);
+        stack->add(*new_tab, std::to_string(++tab_count), tab_title);
+        stack->child_property_position(*new_tab) = position;
+        stack->child_property_title(*new_tab).signal_changed().connect(sigc::mem_fun(
+            on_title_changed, &std::function<void()>::operator()
+        ));
+        new_tab->show();
+
+        // Move all information about the old tab to new one
+        std::replace(tabs.begin(), tabs.end(), old_tab, new_tab);
+        if (tab_last_visible.count(old_tab))
+        {
+            tab_last_visible[new_tab] = tab_last_visible[old_tab];
+            tab_last_visible.erase(old_tab);
+        }
+        if (visible_tab == old_tab)
+            visible_tab = new_tab;
+
+        // Show the new one before removing old one, so that stack doesn't switch to another tab
+        if (stack->get_visible_child() == old_tab)
+            stack->set_visible_child(*new_tab);
+        stack->remove(*old_tab);
+    };
+
+    // Lambda function to call periodically, hibernates tabs hidden for long time
+    on_hibernation_timer = [&]() -> bool
+    {
+        if (tab_hibernate_after == 0) return true;
+
+        auto now = std::chrono::steady_clock::now();
+        for (auto tab : tabs)
+        {
+
+            // Skip visible, already hibernated, not answered yet and recently visible tabs
+            if (tab == stack->get_visible_child() || hibernated_tabs.count(tab) || hibernating_tabs.count(tab))
+                continue;
+            auto last_visible = tab_last_visible.find(tab);
+            if (last_visible != tab_last_visible.end()
+                && now - last_visible->second < std::chrono::seconds(tab_hibernate_after))
+                continue;
+
+            // Ask the page for scroll position, hibernation finishes when it answers
+            hibernating_tabs.insert(tab);
+            webkit_web_view_run_javascript(WEBKIT_WEB_VIEW(tab->gobj()), "window.scrollY", nullptr,
+                on_webview_scroll_position,
+                new std::pair<std::function<void(Gtk::Widget*, double)>*, std::vector<Gtk::Widget*>*>(
+                    &hibernate_tab, &tabs
+                )
+            );
+        }
+
+        // Keep the timer running
+        return true;
+    };
+
+    // Lambda function to replace a webview with a placeholder, remembering what it showed
+    hibernate_tab = [&](Gtk::Widget* tab, double scroll) -> void
+    {
+
+        // The tab might be shown meanwhile
+        hibernating_tabs.erase(tab);
+        if (tab == stack->get_visible_child())
+            return;
+
+        // A page loaded from HTML has only the base URI, keep the HTML unless the user followed a link
+        const char* uri = webkit_web_view_get_uri(WEBKIT_WEB_VIEW(tab->gobj()));
+        Gtk::Widget* placeholder = Gtk::manage(new Gtk::Label("Loading"));
+        std::string page = uri ? uri : "";
+        auto html = tab_html.find(tab);
+        if (html != tab_html.end() && (page.empty() || page == "file:///" || page.rfind("file:///#", 0) == 0))
+            hibernated_tabs[placeholder] = std::make_tuple(html->second, false, scroll);
+        else
+            hibernated_tabs[placeholder] = std::make_tuple(
+                uri ? page : std::string("file://") + ASSETS_DIR + "/welcome.html",
+                true,
+                scroll
+            );
+        tab_html.erase(tab);
+        replace_tab(tab, placeholder);
+    };
+
+    // Lambda function to create a webview again for a hibernated tab
+    restore_tab = [&](Gtk::Widget* placeholder) -> void
+    {
+        auto [content, is_uri, scroll] = hibernated_tabs[placeholder];
+        hibernated_tabs.erase(placeholder);
+
+        // Load the same URI or HTML, and scroll to same position once loaded
+        Gtk::Widget* webview;
+        if (is_uri)
+            webview = create_webview(content);
+        else
+        {
+            webview = new_webview();
+            webkit_web_view_load_html(WEBKIT_WEB_VIEW(webview->gobj()), content.c_str(), "file:///");
+        }
+        if (scroll > 0)
+            g_signal_connect_data(webview->gobj(), "load-changed",
+                G_CALLBACK(on_restored_webview_load_change), new double(scroll),
+                [](void* scroll, GClosure*) -> void { delete (double*)scroll; }, GConnectFlags(0)
+            );
+
+        // The stack keeps it alive from now
+        replace_tab(placeholder, webview);
+        g_object_unref(webview->gobj());
+        if (!is_uri)
+            tab_html[webview] = content;
+    };
+
     // Lambda function to call on webview refresh button clicked
     on_webview_refresh_button_clicked = [&]() -> void
     {
@@ -664,6 +1613,9 @@ int main(int argc, char** argv)
     on_search_changed = [&]() -> void
     {
 
+        // A newer query supersedes the pending one, so drop it
+        search_pending.disconnect();
+
         // If search entry is empty, reset sidebar to it's original state
         if (search_entry->get_text().empty())
         {
@@ -672,6 +1624,23 @@ int main(int argc, char** argv)
             return;
         }
 
+        // Wait until user pauses typing, slower searches get a longer window
+        search_pending = Glib::signal_timeout().connect(
+            sigc::mem_fun(on_search_timeout, &std::function<bool()>::operator()),
+            std::clamp<long>(
+                std::chrono::duration_cast<std::chrono::milliseconds>(search_latency * 2).count(),
+                20, 300
+            )
+        );
+    };
+
+    // Lambda function to call when user paused typing search query
+    on_search_timeout = [&]() -> bool
+    {
+
+        // Time the search to adapt the debounce window
+        auto search_start = std::chrono::steady_clock::now();
+
         // Change the data holder of sidebar
         sidebar_tree->set_model(sidebar_search_results);
 
@@ -700,6 +1669,12 @@ int main(int argc, char** argv)
         }
 
         window->show_all_children();
+
+        // Update moving average of search latency
+        search_latency = (search_latency * 3 + (std::chrono::steady_clock::now() - search_start)) / 4;
+
+        // Run only once
+        return false;
     };
 
     // Lambda function to call on quit button clicked
@@ -730,41 +1705,340 @@ int main(int argc, char** argv)
                 paths.push_back(path);
         }
 
-        // Clear the sidebar
-        sidebar_contents->clear();
+        // Stop the previous scan, it's results are outdated
+        cancel_scan();
 
-        // Clear the all known nodes
+        // Forget all known nodes
+        for (auto& root : document_root_nodes)
+            docview::release_doc_tree(root.first);
         document_root_nodes.clear();
+        unclaimed_files.clear();
 
-        // Populate the sidebar again
-        for (auto& path : paths)
+        // Clear the sidebar, unless this scan revalidates the restored snapshot
+        if (!snapshot_pending)
         {
+            sidebar_contents->clear();
+            snapshot_rows.clear();
+        }
+        sidebar_rows.clear();
+        snapshot_pending = false;
 
-            // Make sure path is an directory
-            if (!std::filesystem::exists(path) || !std::filesystem::is_directory(path))
-                continue;
+        // Change sidebar contents
+        sidebar_tree->set_model(sidebar_contents);
+        search_entry->set_text(Glib::ustring());
 
-            // For every file, try to parse it, do nothing on failure
-            for (auto& file : std::filesystem::directory_iterator(path))
+        // Parse everything in background, the sidebar is populated as results arrive
+        scan_patching = false;
+        start_scan(paths, {}, {});
+
+        window->show_all_children();
+    };
+
+    // Lambda function to parse files in directories and given files in background
+    start_scan = [&](
+        std::vector<std::filesystem::path> directories,
+        std::vector<std::filesystem::path> files,
+        std::filesystem::path extension
+    ) -> void
+    {
+        scan_cancelled = false;
+        scan_finished = false;
+        scan_done = 0;
+        scan_total = 0;
+        sidebar_complete = false;
+        scan_thread = std::thread([&, directories, files, extension]() mutable -> void
+        {
+
+            // List all files first, so that progress can be shown
+            auto phase_begin = std::chrono::steady_clock::now();
+            for (auto& path : directories)
+            {
+                auto found = docview::find_documents(path, documentation_search_depth);
+                files.insert(files.end(), found.begin(), found.end());
+            }
+            scan_total = files.size();
+            timeline.record("Directory scanning", phase_begin);
+
+            // Parse files in chunks, files of a chunk are parsed in parallel
+            constexpr unsigned long chunk_size = 256;
+            for (unsigned long begin = 0; begin < files.size() && !scan_cancelled; begin += chunk_size)
             {
+                std::vector<std::filesystem::path> chunk(
+                    files.begin() + begin,
+                    files.begin() + std::min(begin + chunk_size, (unsigned long)files.size())
+                );
+
+                // Try to parse them, with given extension only if given
+                std::vector<const docview::doc_tree_node*> nodes(chunk.size(), nullptr);
+                phase_begin = std::chrono::steady_clock::now();
                 try
                 {
-                    const docview::doc_tree_node* node = docview::get_doc_tree(file);
-                    if (node)
+                    if (extension.empty())
+                        nodes = docview::get_doc_trees(chunk);
+                    else
+                        for (unsigned long i = 0; i < chunk.size(); i++)
+                            nodes[i] = docview::get_doc_tree(chunk[i], extension);
+                }
+                catch (...) {}
+                timeline.record("Document parsing", phase_begin);
+
+                // Queue the results, wake up main loop only if it isn't awake already
+                {
+                    std::lock_guard<std::mutex> lock(scan_results_mutex);
+                    bool was_empty = scan_results.empty();
+                    for (unsigned long i = 0; i < nodes.size(); i++)
                     {
-                        document_root_nodes.push_back(std::make_pair(node, file.path()));
-                        build_tree(node, sidebar_contents->append());
+
+                        // Failure of a single extension doesn't make the file unclaimed
+                        if (nodes[i] || extension.empty())
+                            scan_results.push_back(std::make_pair(nodes[i], chunk[i]));
                     }
+                    scan_done += chunk.size();
+                    if (was_empty)
+                        scan_dispatcher.emit();
                 }
-                catch (...) {}
             }
+
+            // Notify main loop that scanning is done
+            scan_finished = true;
+            scan_dispatcher.emit();
+        });
+    };
+
+    // Lambda function to call on scanning thread has some results
+    on_scan_progress = [&]() -> void
+    {
+
+        // Maximum number of root nodes added at once, to keep UI responsive
+        constexpr unsigned long batch_size = 64;
+
+        // Take a batch of results
+        std::vector<std::pair<const docview::doc_tree_node*, std::filesystem::path>> batch;
+        bool results_left;
+        {
+            std::lock_guard<std::mutex> lock(scan_results_mutex);
+            while (!scan_results.empty() && batch.size() < batch_size)
+            {
+                batch.push_back(scan_results.front());
+                scan_results.pop_front();
+            }
+            results_left = !scan_results.empty();
         }
 
-        // Change sidebar contents
-        sidebar_tree->set_model(sidebar_contents);
-        search_entry->set_text(Glib::ustring());
+        // Add them to sidebar
+        auto phase_begin = std::chrono::steady_clock::now();
+        for (auto& result : batch)
+        {
 
-        window->show_all_children();
+            // A restored row for this file is either revalidated or removed
+            auto snapshot_row = snapshot_rows.find(result.second);
+            if (snapshot_row != snapshot_rows.end())
+            {
+                if (result.first)
+                {
+                    document_root_nodes.push_back(result);
+                    sidebar_rows[result.first] = snapshot_row->second;
+                    patch_tree(result.first, snapshot_row->second);
+                }
+                else
+                    sidebar_contents->erase(snapshot_row->second);
+                snapshot_rows.erase(snapshot_row);
+                if (result.first) continue;
+            }
+
+            // No extension could parse it, remember it for extensions enabled later
+            if (!result.first)
+            {
+                unclaimed_files.push_back(result.second);
+                continue;
+            }
+
+            // When patching, the file might be unclaimed or already in sidebar
+            if (scan_patching)
+            {
+                unclaimed_files.erase(
+                    std::remove(unclaimed_files.begin(), unclaimed_files.end(), result.second),
+                    unclaimed_files.end()
+                );
+
+                auto known = std::find_if(document_root_nodes.begin(), document_root_nodes.end(),
+                    [&](auto& root) { return root.second == result.second; }
+                );
+                if (known != document_root_nodes.end())
+                {
+
+                    // Replace the old tree in place, or add a row if it has none yet
+                    auto row = sidebar_rows.find(known->first);
+                    docview::release_doc_tree(known->first);
+                    known->first = result.first;
+                    if (row == sidebar_rows.end())
+                    {
+                        auto new_row = sidebar_contents->append();
+                        sidebar_rows[result.first] = new_row;
+                        build_tree(result.first, new_row);
+                        continue;
+                    }
+                    auto sidebar_row = row->second;
+                    sidebar_rows.erase(row);
+                    sidebar_rows[result.first] = sidebar_row;
+                    while (!sidebar_row->children().empty())
+                        sidebar_contents->erase(sidebar_row->children().begin());
+                    build_tree(result.first, sidebar_row);
+                    continue;
+                }
+            }
+
+            document_root_nodes.push_back(result);
+            auto row = sidebar_contents->append();
+            sidebar_rows[result.first] = row;
+            build_tree(result.first, row);
+        }
+        timeline.record("Tree building", phase_begin);
+
+        // Show progress in search entry, hide it when everything is done
+        if (scan_finished && !results_left)
+        {
+            search_entry->set_progress_fraction(0);
+            sidebar_complete = !scan_cancelled;
+
+            // Restored rows not revalidated by a complete scan belong to removed files
+            if (sidebar_complete)
+            {
+                for (auto& row : snapshot_rows)
+                    sidebar_contents->erase(row.second);
+                snapshot_rows.clear();
+
+                // Startup is over once the first scan completes
+                timeline.write();
+            }
+        }
+        else if (scan_total)
+            search_entry->set_progress_fraction(double(scan_done) / scan_total);
+
+        // Launches might be waiting for these documents
+        if (!launch_requests.empty())
+            open_launch_requests();
+
+        // Come back later for remaining results
+        if (results_left)
+            scan_dispatcher.emit();
+    };
+
+    // Lambda function to stop the scanning thread and discard it's results
+    cancel_scan = [&]() -> void
+    {
+        scan_cancelled = true;
+        if (scan_thread.joinable())
+            scan_thread.join();
+
+        // Extensions might be unloaded after this, so documents must not be fetched meanwhile
+        cancel_doc_fetches();
+
+        // Trees parsed but not added to sidebar are still registered in libdocview, release them
+        std::lock_guard<std::mutex> lock(scan_results_mutex);
+        for (auto& result : scan_results)
+            if (result.first)
+                docview::release_doc_tree(result.first);
+        scan_results.clear();
+        search_entry->set_progress_fraction(0);
+    };
+
+    // Lambda function to fill sidebar with the snapshot of previous session
+    restore_sidebar_snapshot = [&]() -> void
+    {
+        std::ifstream snapshot(sidebar_snapshot_file);
+        std::string line;
+
+        // Make sure it's a snapshot of a known version
+        if (!std::getline(snapshot, line) || line != "docview-sidebar-snapshot 1")
+            return;
+
+        // Rows of current root and it's ancestors of current node, by depth
+        std::vector<Gtk::TreeStore::iterator> ancestors;
+
+        while (std::getline(snapshot, line))
+        {
+            auto separator = line.find('\t');
+            if (separator == std::string::npos)
+                continue;
+
+            // Lines starting with "R" begin a new root, others are nodes with their depth
+            std::string field = unescape_snapshot_field(line.substr(separator + 1));
+            if (line.compare(0, separator, "R") == 0)
+            {
+                ancestors.clear();
+                auto row = sidebar_contents->append();
+                snapshot_rows[field] = row;
+                ancestors.push_back(row);
+                continue;
+            }
+
+            unsigned long depth = std::strtoul(line.c_str(), nullptr, 10);
+            if (ancestors.empty() || depth > ancestors.size())
+                continue;
+            ancestors.resize(std::max(depth, 1ul));
+            auto row = depth == 0 ? ancestors[0] : sidebar_contents->append(ancestors[depth - 1]->children());
+            (*row)[sidebar_column_title] = field;
+            (*row)[sidebar_column_node] = nullptr;
+            if (depth > 0)
+                ancestors.push_back(row);
+        }
+
+        // Next scan revalidates these rows, instead of starting from scratch
+        snapshot_pending = !snapshot_rows.empty();
+    };
+
+    // Lambda function to save the sidebar for next session
+    save_sidebar_snapshot = [&]() -> void
+    {
+
+        // Writes a node and it's children
+        std::function<void(std::ofstream&, const docview::doc_tree_node*, unsigned long)> write_node =
+            [&](std::ofstream& snapshot, const docview::doc_tree_node* node, unsigned long depth) -> void
+        {
+            snapshot << depth << '\t' << escape_snapshot_field(node->title) << '\n';
+            for (auto& child : node->children)
+                write_node(snapshot, child, depth + 1);
+        };
+
+        // Write to a temporary file first, so that a crash never leaves a half written snapshot
+        std::error_code error;
+        std::filesystem::create_directories(sidebar_snapshot_file.parent_path(), error);
+        std::filesystem::path temporary_file = sidebar_snapshot_file.string() + ".tmp";
+        {
+            std::ofstream snapshot(temporary_file);
+            snapshot << "docview-sidebar-snapshot 1\n";
+            for (auto& root : document_root_nodes)
+            {
+                snapshot << "R\t" << escape_snapshot_field(root.second) << '\n';
+                write_node(snapshot, root.first, 0);
+            }
+            if (!snapshot.flush())
+                return;
+        }
+        std::filesystem::rename(temporary_file, sidebar_snapshot_file, error);
+    };
+
+    // Lambda function to make a restored sidebar row point to a parsed tree
+    patch_tree = [&](const docview::doc_tree_node* node, Gtk::TreeStore::iterator row) -> void
+    {
+
+        // If the shape changed, rebuild the subtree
+        if (row->children().size() != node->children.size())
+        {
+            while (!row->children().empty())
+                sidebar_contents->erase(row->children().begin());
+            build_tree(node, row);
+            return;
+        }
+
+        // Otherwise reuse the rows, touching titles only if changed
+        if (Glib::ustring((*row)[sidebar_column_title]) != node->title)
+            (*row)[sidebar_column_title] = node->title;
+        (*row)[sidebar_column_node] = node;
+        auto child_row = row->children().begin();
+        for (auto& child : node->children)
+            patch_tree(child, child_row++);
     };
 
     // Lambda function to call on preferences use system fonts switch changed
@@ -863,6 +2137,9 @@ int main(int argc, char** argv)
         // Iterator to the row
         Gtk::TreeModel::iterator it = extension_list_contents->get_iter(path);
 
+        // Whether the sidebar can be patched, instead of scanning everything again
+        bool incremental = false;
+
         // Make sure the iterator is valid
         if (path)
         {
@@ -878,27 +2155,116 @@ int main(int argc, char** argv)
                 std::to_string(row[extension_list_column_enabled])
             );
 
+            std::filesystem::path extension = (std::string)row[extension_list_column_path];
+
+            // Patching is possible only if the sidebar is up to date
+            incremental = sidebar_complete;
+
+            // Stop scanning, as extensions are going to change
+            cancel_scan();
+
             if (row[extension_list_column_enabled])
             {
-                docview::load_ext((std::string)row[extension_list_column_path]);
-                loaded_extensions.push_back((std::string)row[extension_list_column_path]);
+                docview::load_ext(extension);
+                loaded_extensions.push_back(extension);
+
+                if (incremental)
+                {
+
+                    // The extension is tried before extensions with higher applicability level, so it
+                    // might claim files parsed by them, in addition to files nobody could parse
+                    auto level = docview::get_applicability_level(extension);
+                    std::vector<std::filesystem::path> files = unclaimed_files;
+                    std::vector<const docview::doc_tree_node*> roots;
+                    for (auto& root : document_root_nodes)
+                        roots.push_back(root.first);
+                    auto owners = docview::get_owners(roots);
+                    std::map<std::filesystem::path, docview::extension::applicability_level> owner_levels;
+                    for (unsigned long i = 0; i < owners.size(); i++)
+                    {
+                        auto owner_level = owner_levels.find(owners[i]);
+                        if (owner_level == owner_levels.end())
+                            owner_level = owner_levels.emplace(
+                                owners[i], docview::get_applicability_level(owners[i])
+                            ).first;
+                        if (owner_level->second > level)
+                            files.push_back(document_root_nodes[i].second);
+                    }
+
+                    scan_patching = true;
+                    start_scan({}, files, extension);
+                }
             }
             else
             {
-                docview::unload_ext((std::string)row[extension_list_column_path]);
+
+                // Trees parsed by the extension become invalid, remove them from sidebar
+                std::vector<std::filesystem::path> files;
+                if (incremental)
+                {
+                    std::vector<const docview::doc_tree_node*> roots;
+                    for (auto& root : document_root_nodes)
+                        roots.push_back(root.first);
+                    auto owners = docview::get_owners(roots);
+                    std::map<std::filesystem::path, bool> owned;
+                    for (auto& owner : owners)
+                        if (!owned.count(owner))
+                        {
+                            std::error_code error;
+                            owned[owner] = std::filesystem::equivalent(owner, extension, error);
+                        }
+
+                    std::vector<std::pair<const docview::doc_tree_node*, std::filesystem::path>> kept_roots;
+                    for (unsigned long i = 0; i < document_root_nodes.size(); i++)
+                    {
+                        auto& root = document_root_nodes[i];
+                        if (!owned[owners[i]])
+                        {
+                            kept_roots.push_back(root);
+                            continue;
+                        }
+
+                        // The root might have no row yet, if it's result is still queued
+                        auto row = sidebar_rows.find(root.first);
+                        if (row != sidebar_rows.end())
+                        {
+                            sidebar_contents->erase(row->second);
+                            sidebar_rows.erase(row);
+                        }
+                        files.push_back(root.second);
+                    }
+                    document_root_nodes.swap(kept_roots);
+                }
+
+                docview::unload_ext(extension);
                 for (auto it = loaded_extensions.begin(); it != loaded_extensions.end(); it++)
                 {
-                    if (*it == (std::string)row[extension_list_column_path])
+                    if (*it == extension)
                     {
                         loaded_extensions.erase(it);
                         break;
                     }
                 }
+
+                // Other extensions might be able to parse those files
+                if (incremental)
+                {
+                    scan_patching = true;
+                    start_scan({}, files, {});
+                }
             }
         }
 
-        // Update the sidebar
-        on_preferences_documentation_search_path_unfocused();
+        // Update the whole sidebar if patching isn't possible
+        if (!incremental)
+        {
+            on_preferences_documentation_search_path_unfocused();
+            return;
+        }
+
+        // Search results might point to replaced nodes
+        sidebar_tree->set_model(sidebar_contents);
+        search_entry->set_text(Glib::ustring());
     };
 
     // Lambda function to call on extension search path expander state changed
@@ -934,6 +2300,9 @@ int main(int argc, char** argv)
         // Clear the list
         extension_list_contents->clear();
 
+        // Stop scanning, as extensions are going to change
+        cancel_scan();
+
         // Unload all extensions
         for (auto& extension : loaded_extensions)
         {
@@ -942,6 +2311,7 @@ int main(int argc, char** argv)
         loaded_extensions.clear();
 
         // Create the list again
+        auto phase_begin = std::chrono::steady_clock::now();
         for (auto& path : paths)
         {
             if (!std::filesystem::exists(path) || !std::filesystem::is_directory(path))
@@ -985,6 +2355,8 @@ int main(int argc, char** argv)
                 }
         }
 
+        timeline.record("Extension loading", phase_begin);
+
         // Update the sidebar
         on_preferences_documentation_search_path_unfocused();
 
@@ -1024,6 +2396,15 @@ int main(int argc, char** argv)
     preferences_extension_search_path_buffer->set_text(config.get_value(
         {"preferences", "extensions", "search_path"}
     ));
+
+    // The file is editable by the user, so fall back to defaults for values which aren't numbers
+    unsigned long config_number;
+    tab_hibernate_after = parse_number(config.get_value(
+        {"preferences", "interface", "tabs", "hibernate_after"}
+    ), config_number) && config_number <= std::numeric_limits<unsigned int>::max() ? config_number : 600;
+    documentation_search_depth = parse_number(config.get_value(
+        {"preferences", "documentations", "search_depth"}
+    ), config_number) && config_number <= std::numeric_limits<unsigned int>::max() ? config_number : 1;
     preferences_max_search_results->set_value(config.get_value(
         {"preferences", "interface", "search", "max_results"}
     ) == "" ? 500 : std::stoi(config.get_value(
@@ -1111,6 +2492,14 @@ int main(int argc, char** argv)
         on_preferences_close_button_clicked,
         &std::function<void()>::operator()
     ));
+    app->signal_command_line().connect(sigc::mem_fun(on_command_line,
+        &std::function<int(const Glib::RefPtr<Gio::ApplicationCommandLine>&)>::operator()
+    ), false);
+    scan_dispatcher.connect(sigc::mem_fun(on_scan_progress, &std::function<void()>::operator()));
+    doc_dispatcher.connect(sigc::mem_fun(on_doc_fetched, &std::function<void()>::operator()));
+    Glib::signal_timeout().connect_seconds(
+        sigc::mem_fun(on_hibernation_timer, &std::function<bool()>::operator()), 30
+    );
 
     // Manually trigger tab added handler, which will create the initial tab
     on_tab_added();
@@ -1149,6 +2538,11 @@ int main(int argc, char** argv)
     sidebar_tree->set_model(sidebar_contents);
     sidebar_tree->append_column("title", sidebar_column_title);
 
+    // Show the sidebar of previous session, the scan below revalidates it
+    phase_begin = std::chrono::steady_clock::now();
+    restore_sidebar_snapshot();
+    timeline.record("Snapshot restoring", phase_begin);
+
     // Trigger the following event, which will fill the extension list and sidebar
     on_preferences_extension_search_path_unfocused();
 
@@ -1159,9 +2553,50 @@ int main(int argc, char** argv)
     window->show_all_children();
     about_dialog->show_all_children();
 
+    // Record time till the window is painted first time
+    phase_begin = std::chrono::steady_clock::now();
+    sigc::connection first_paint;
+    std::function<bool(const Cairo::RefPtr<Cairo::Context>&)> on_first_paint =
+        [&](const Cairo::RefPtr<Cairo::Context>&) -> bool
+    {
+        timeline.record("First paint", phase_begin);
+        first_paint.disconnect();
+        return false;
+    };
+    first_paint = window->signal_draw().connect(sigc::mem_fun(
+        on_first_paint, &std::function<bool(const Cairo::RefPtr<Cairo::Context>&)>::operator()
+    ));
+
     // Store status in a variable, as we might need to do some destruction tasks manually
     int status = app->run(*window);
 
+    // Write startup timeline, if startup didn't finish before exit
+    timeline.write();
+
+    // Stop scanning, the thread must not outlive the objects it uses
+    cancel_scan();
+
+    // Same for the document fetching thread
+    {
+        std::lock_guard<std::mutex> lock(doc_mutex);
+        doc_thread_exit = true;
+    }
+    doc_condition.notify_all();
+    if (doc_thread.joinable())
+        doc_thread.join();
+
+    // Destroy unused prewarmed webviews
+    for (auto webview : prewarmed_webviews)
+    {
+        gtk_widget_destroy(webview->gobj());
+        g_object_unref(webview->gobj());
+    }
+    prewarmed_webviews.clear();
+
+    // Save the sidebar for next session, only if it's up to date
+    if (sidebar_complete)
+        save_sidebar_snapshot();
+
     // Save max search result setting
     config.set_value(
         {"preferences", "interface", "search", "max_results"},
@@ -101,7 +101,7 @@ void docview_unload_ext(const char* path);
  * @param path path to extension
  * @return whether extension at given path is loaded
  */
-bool docview_ext_is_loaded(std::filesystem::path path);
+bool docview_ext_is_loaded(const char* path);
 
 /**
  * @brief Structure for holding a document node
@@ -348,6 +348,112 @@ typedef void docview_doc_tree_node;
  */
 docview_doc_tree_node* docview_get_docs_tree(const char* path);
 
+/**
+ * @brief Returns pointers to document trees of several paths
+ * 
+ * @details @rst
+ * 
+ * This function parses all paths in the ``NULL`` terminated array ``paths``
+ * concurrently and returns an array of pointers to their document trees in the
+ * same order. An element is ``NULL`` if the path couldn't be parsed, so the
+ * returned array is not ``NULL`` terminated, it has as many elements as
+ * ``paths``. The array should be freed by the application, but not the
+ * document trees.
+ * 
+ * @endrst
+ * 
+ * @param paths NULL terminated array of paths to documents
+ * 
+ * @return array of pointers to document trees
+ */
+docview_doc_tree_node** docview_get_docs_trees(const char* const* paths);
+
+/**
+ * @brief Returns a pointer to document tree of a path parsed by given extension
+ * 
+ * @details @rst
+ * 
+ * This function is same as :cpp:func:`docview_get_docs_tree`, except that only
+ * the extension loaded from ``extension`` is tried, regardless of
+ * applicability levels. Returns ``NULL`` on failure, or if the extension isn't
+ * loaded.
+ * 
+ * @endrst
+ * 
+ * @param path path to documents
+ * @param extension path to a loaded extension
+ * 
+ * @return pointer to document tree
+ */
+docview_doc_tree_node* docview_get_docs_tree_with_ext(const char* path, const char* extension);
+
+/**
+ * @brief Returns all files and directories under a directory, which might be documents
+ * 
+ * @details @rst
+ * 
+ * This function walks ``directory`` recursively and returns paths of all
+ * regular files and directories found, sorted, in a ``NULL`` terminated array.
+ * Entries directly inside ``directory`` are at depth 1, subdirectories are
+ * walked until ``max_depth`` is reached, or without a limit if ``max_depth``
+ * is zero. Symbolic link cycles are harmless. The array and the strings should
+ * be freed by the application.
+ * 
+ * @endrst
+ * 
+ * @param directory the directory to walk
+ * @param max_depth maximum depth to walk, zero for unlimited
+ * @return NULL terminated array of paths
+ */
+const char* const* docview_find_documents(const char* directory, unsigned int max_depth);
+
+/**
+ * @brief Releases a document tree, which is no longer needed
+ * 
+ * @details @rst
+ * 
+ * This function makes libdocview forget the document tree with given root, so
+ * it won't appear in search results anymore and it's nodes become invalid.
+ * Memory used by the tree is still managed by the extension.
+ * 
+ * @endrst
+ * 
+ * @param root root node of document tree
+ */
+void docview_release_docs_tree(const docview_doc_tree_node* root);
+
+/**
+ * @brief Returns the path of extension which owns a node
+ * 
+ * @details @rst
+ * 
+ * This function returns the path of extension which parsed the document tree
+ * containing ``node``, ``NULL`` if the node isn't valid. The returned string
+ * should be freed by the application.
+ * 
+ * @endrst
+ * 
+ * @param node pointer to document node
+ * @return path to extension
+ */
+const char* docview_get_owner(const docview_doc_tree_node* node);
+
+/**
+ * @brief Returns the applicability level of a loaded extension
+ * 
+ * @details @rst
+ * 
+ * This function stores the applicability level of the extension at given path
+ * to ``level``. Returns ``false`` if the extension isn't loaded.
+ * 
+ * @endrst
+ * 
+ * @param path path to extension
+ * @param level pointer to store applicability level to
+ * @return true on success, false on failure
+ */
+bool docview_get_applicability_level(const char* path, docview_extension_applicability_level* level);
+
 /**
  * @brief Returns the path or HTML content of document
  * 
@@ -409,9 +515,10 @@ const char* docview_get_details(docview_doc_tree_node* node);
  * @endrst
  * 
  * @param node pointer to a node in document tree
+ * @param section the name of section
  * @return details of from document
  */
-const char* docview_get_section(docview_doc_tree_node* node);
+const char* docview_get_section(docview_doc_tree_node* node, const char* section);
 
 /**
  * @brief Searches through all loaded document tree
@@ -431,6 +538,106 @@ const char* docview_get_section(docview_doc_tree_node* node);
  */
 const docview_doc_tree_node* const* docview_search(const char* query);
 
+/**
+ * @brief Finds nodes whose title or any synonym is exactly given name
+ * 
+ * @details @rst
+ * 
+ * This function answers exact queries from a hash index of titles and synonyms
+ * of all loaded document trees. See :cpp:func:`docview::lookup` for details.
+ * The array should be freed by the application.
+ * 
+ * @endrst
+ * 
+ * @param name the exact title or synonym
+ * @return NULL terminated array with nodes of matched documents
+ */
+const docview_doc_tree_node* const* docview_lookup(const char* name);
+
+/**
+ * @brief Finds nodes whose title or any synonym contains given query
+ * 
+ * @details @rst
+ * 
+ * This function finds nodes by any part of their name, using a trigram index.
+ * See :cpp:func:`docview::search_substring` for details. The array should be
+ * freed by the application.
+ * 
+ * @endrst
+ * 
+ * @param query the search query
+ * @return NULL terminated array with nodes of matched documents
+ */
+const docview_doc_tree_node* const* docview_search_substring(const char* query);
+
+/**
+ * @brief Finds nodes whose title or any synonym is within given edit distance of query
+ * 
+ * @details @rst
+ * 
+ * This function finds nodes despite typos in the query, nearer nodes come
+ * first. See :cpp:func:`docview::search_fuzzy` for details. The array should be
+ * freed by the application.
+ * 
+ * @endrst
+ * 
+ * @param query the search query
+ * @param max_distance maximum edit distance, usually 1 or 2
+ * @return NULL terminated array with nodes of matched documents
+ */
+const docview_doc_tree_node* const* docview_search_fuzzy(const char* query, unsigned int max_distance);
+
+/**
+ * @brief Finds nodes whose title or any synonym matches a regular expression
+ * 
+ * @details @rst
+ * 
+ * This function finds nodes with a pattern like ``^g_.*_free$``. See
+ * :cpp:func:`docview::search_regex` for supported syntax. The array should be
+ * freed by the application.
+ * 
+ * @endrst
+ * 
+ * @param pattern the regular expression
+ * @return NULL terminated array with nodes of matched documents, ``NULL`` if
+ * the pattern is invalid
+ */
+const docview_doc_tree_node* const* docview_search_regex(const char* pattern);
+
+/**
+ * @brief Searches for nodes scoped by names of their ancestors
+ * 
+ * @details @rst
+ * 
+ * This function searches with queries like ``Window::set_title`` or
+ * ``gtk > Window > set``. See :cpp:func:`docview::search_path` for details.
+ * The array should be freed by the application.
+ * 
+ * @endrst
+ * 
+ * @param query the search query
+ * @return NULL terminated array with nodes of matched documents
+ */
+const docview_doc_tree_node* const* docview_search_path(const char* query);
+
+/**
+ * @brief Searches through the subtree of a node
+ * 
+ * @details @rst
+ * 
+ * This function searches like ``docview_search()``, but only through the
+ * given node and it's descendants. See :cpp:func:`docview::search_within` for
+ * details. The array should be freed by the application.
+ * 
+ * @endrst
+ * 
+ * @param node pointer to a node in document tree
+ * @param query the search query
+ * @return NULL terminated array with nodes of matched documents, ``NULL`` if
+ * the node isn't in a loaded document tree
+ */
+const docview_doc_tree_node* const* docview_search_within(const docview_doc_tree_node* node, const char* query);
+
 /**
  * @brief Checks whether a document node is still valid
  * 
@@ -447,6 +654,351 @@ const docview_doc_tree_node* const* docview_search(const char* query);
  */
 bool docview_validate(const docview_doc_tree_node* node);
 
+/**
+ * @brief Returns the recorded trace in Chrome trace event format
+ * 
+ * @details @rst
+ * 
+ * This function returns a JSON object with an array ``traceEvents``, which is
+ * always empty unless libdocview is configured with ``--enable-tracing``. The
+ * returned string should be freed by the application.
+ * 
+ * @endrst
+ * 
+ * @return trace as JSON
+ */
+const char* docview_export_trace();
+
+/**
+ * @brief Structure for holding a snapshot of runtime statistics
+ * 
+ */
+struct docview_statistics
+{
+    /**
+     * @brief Number of loaded extensions
+     * 
+     */
+    unsigned long loaded_extensions;
+
+    /**
+     * @brief Number of loaded extensions which declared themselves thread safe
+     * 
+     */
+    unsigned long thread_safe_extensions;
+
+    /**
+     * @brief Number of loaded extensions written in C
+     * 
+     */
+    unsigned long c_extensions;
+
+    /**
+     * @brief Number of live document trees
+     * 
+     */
+    unsigned long roots;
+
+    /**
+     * @brief Number of nodes in live document trees
+     * 
+     */
+    unsigned long nodes;
+
+    /**
+     * @brief Number of nodes mirrored from extensions written in C, including released trees
+     * 
+     */
+    unsigned long c_extension_nodes;
+
+    /**
+     * @brief Number of lookups of original nodes of extensions written in C, which succeeded
+     * 
+     */
+    unsigned long c_extension_lookup_hits;
+
+    /**
+     * @brief Number of lookups of original nodes of extensions written in C, which failed
+     * 
+     */
+    unsigned long c_extension_lookup_misses;
+
+    /**
+     * @brief Number of worker threads in thread pool
+     * 
+     */
+    unsigned long pool_threads;
+
+    /**
+     * @brief Number of tasks waiting in thread pool queues
+     * 
+     */
+    unsigned long pool_queued_tasks;
+
+    /**
+     * @brief Number of tasks run by thread pool
+     * 
+     */
+    unsigned long pool_tasks_run;
+
+    /**
+     * @brief Number of tasks stolen by idle workers from other workers
+     * 
+     */
+    unsigned long pool_tasks_stolen;
+
+    /**
+     * @brief Generation of the last shared index published by this process, 0 if none
+     * 
+     */
+    unsigned long shared_index_generation;
+
+    /**
+     * @brief Size of the last shared index published by this process, in bytes
+     * 
+     */
+    unsigned long shared_index_bytes;
+
+    /**
+     * @brief Number of distinct titles and synonyms in the lookup index
+     * 
+     */
+    unsigned long index_terms;
+
+    /**
+     * @brief Number of distinct trigrams in the substring search index
+     * 
+     */
+    unsigned long index_trigrams;
+
+    /**
+     * @brief Number of document trees added but not indexed yet, they are indexed on next lookup
+     * 
+     */
+    unsigned long index_pending_roots;
+
+    /**
+     * @brief Number of lookups in the index
+     * 
+     */
+    unsigned long index_lookups;
+};
+
+/**
+ * @brief Returns a snapshot of runtime statistics
+ * 
+ * @details @rst
+ * 
+ * This function returns counters describing the state of libdocview, like
+ * loaded extensions, live document trees and the thread pool. See
+ * :cpp:func:`docview::stats` for details.
+ * 
+ * @endrst
+ * 
+ * @return statistics
+ */
+struct docview_statistics docview_stats();
+
+/**
+ * @brief Structure for holding allocation counts of a function or subsystem
+ * 
+ */
+struct docview_allocation_count
+{
+
+    /**
+     * @brief Name of the public API function or internal subsystem
+     * 
+     */
+    const char* name;
+
+    /**
+     * @brief Whether it's a public API function
+     * 
+     */
+    bool api;
+
+    /**
+     * @brief Number of allocations made
+     * 
+     */
+    unsigned long allocations;
+
+    /**
+     * @brief Number of bytes allocated
+     * 
+     */
+    unsigned long bytes;
+};
+
+/**
+ * @brief Returns the number of allocations made by libdocview
+ * 
+ * @details @rst
+ * 
+ * This function returns an array of allocation counts of every public API
+ * function and internal subsystem called till now, terminated by an element
+ * with ``NULL`` name. Counting is only compiled when libdocview is configured
+ * with ``--enable-allocation-accounting``, otherwise the array is always empty.
+ * The array and the names should be freed by the application.
+ * 
+ * @endrst
+ * 
+ * @return array of allocation counts
+ */
+struct docview_allocation_count* docview_get_allocation_counts();
+
+/**
+ * @brief Resets all allocation counts to zero
+ * 
+ */
+void docview_reset_allocation_counts();
+
+/**
+ * @brief Publishes all live document trees as a shared index
+ * 
+ * @details @rst
+ * 
+ * This function flattens all live document trees into a read only shared
+ * memory object, which other processes can query with
+ * :cpp:func:`docview_open_shared_index`. See
+ * :cpp:func:`docview::publish_shared_index` for details.
+ * 
+ * @endrst
+ * 
+ * @param name name of the index, must not contain ``/``
+ * @return generation of the published index, 0 on failure
+ */
+unsigned long docview_publish_shared_index(const char* name);
+
+/**
+ * @brief Removes a shared index published by any process
+ * 
+ * @param name name of the index
+ */
+void docview_unpublish_shared_index(const char* name);
+
+/**
+ * @brief Define void as docview_shared_index
+ * 
+ */
+typedef void docview_shared_index;
+
+/**
+ * @brief Node number returned when there is no node, also terminates arrays of node numbers
+ * 
+ */
+#define DOCVIEW_SHARED_INDEX_NPOS ((unsigned long)-1)
+
+/**
+ * @brief Maps the current generation of a shared index, ``NULL`` on failure
+ * 
+ * @details @rst
+ * 
+ * This function maps a shared index published with
+ * :cpp:func:`docview_publish_shared_index`, by this or any other process. See
+ * :cpp:class:`docview::shared_index` for details. The index should be closed
+ * with :cpp:func:`docview_close_shared_index`.
+ * 
+ * @endrst
+ * 
+ * @param name name of the index
+ * @return pointer to the index, ``NULL`` on failure
+ */
+docview_shared_index* docview_open_shared_index(const char* name);
+
+/**
+ * @brief Unmaps a shared index
+ * 
+ * @param index pointer to the index
+ */
+void docview_close_shared_index(docview_shared_index* index);
+
+/**
+ * @brief Maps the latest generation of a shared index, if it's newer than the current one
+ * 
+ * @param index pointer to the index
+ * @return whether a newer generation was mapped
+ */
+bool docview_shared_index_refresh(docview_shared_index* index);
+
+/**
+ * @brief Returns the generation of a shared index currently mapped
+ * 
+ * @param index pointer to the index
+ * @return generation
+ */
+unsigned long docview_shared_index_generation(docview_shared_index* index);
+
+/**
+ * @brief Returns the number of nodes in a shared index
+ * 
+ * @param index pointer to the index
+ * @return number of nodes
+ */
+unsigned long docview_shared_index_size(docview_shared_index* index);
+
+/**
+ * @brief Searches a shared index for nodes whose title or any synonym starts with given query
+ * 
+ * @details @rst
+ * 
+ * This function returns an array of node numbers, terminated by
+ * :c:macro:`DOCVIEW_SHARED_INDEX_NPOS`. The array should be freed by the
+ * application.
+ * 
+ * @endrst
+ * 
+ * @param index pointer to the index
+ * @param query search query
+ * @return array of matching nodes
+ */
+const unsigned long* docview_shared_index_search(docview_shared_index* index, const char* query);
+
+/**
+ * @brief Returns the title of a node of a shared index, ``NULL`` if there is no such node
+ * 
+ * @param index pointer to the index
+ * @param node node number
+ * @return title
+ */
+const char* docview_shared_index_title(docview_shared_index* index, unsigned long node);
+
+/**
+ * @brief Returns a NULL terminated array of synonyms of a node of a shared index, ``NULL`` if there is no such node
+ * 
+ * @param index pointer to the index
+ * @param node node number
+ * @return NULL terminated array of synonyms
+ */
+const char* const* docview_shared_index_synonyms(docview_shared_index* index, unsigned long node);
+
+/**
+ * @brief Returns the parent of a node of a shared index
+ * 
+ * @param index pointer to the index
+ * @param node node number
+ * @return parent, DOCVIEW_SHARED_INDEX_NPOS if it's a root or there is no such node
+ */
+unsigned long docview_shared_index_parent(docview_shared_index* index, unsigned long node);
+
+/**
+ * @brief Returns the children of a node of a shared index
+ * 
+ * @details @rst
+ * 
+ * This function returns an array of node numbers, terminated by
+ * :c:macro:`DOCVIEW_SHARED_INDEX_NPOS`, ``NULL`` if there is no such node. The
+ * array should be freed by the application.
+ * 
+ * @endrst
+ * 
+ * @param index pointer to the index
+ * @param node node number
+ * @return array of children
+ */
+const unsigned long* docview_shared_index_children(docview_shared_index* index, unsigned long node);
+
 /**
  * @brief Returns the parent of a document node
  * 
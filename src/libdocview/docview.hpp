@@ -333,6 +333,23 @@ namespace docview
         virtual std::string section(const doc_tree_node* node, std::string section) noexcept;
     };
 
+    /**
+     * @brief Returns the applicability level of a loaded extension
+     * 
+     * @details @rst
+     * 
+     * For more, see ":ref:`applicability-level`".
+     * 
+     * @endrst
+     * 
+     * @param path path to extension
+     * 
+     * @throw std::invalid_argument if extension at given path isn't loaded
+     * 
+     * @return applicability level of extension
+     */
+    extension::applicability_level get_applicability_level(std::filesystem::path path);
+
     /**
      * @brief Returns a pointer to document tree of a path, nullptr on failure
      * 
@@ -350,6 +367,126 @@ namespace docview
      */
     const doc_tree_node* get_doc_tree(std::filesystem::path path);
 
+    /**
+     * @brief Returns pointers to document trees of several paths
+     * 
+     * @details @rst
+     * 
+     * This function parses all given paths concurrently on a pool of threads
+     * and returns pointers to their document trees in the same order as
+     * ``paths``. The pointer is ``nullptr`` if the path doesn't exist, can't
+     * be accessed or couldn't be parsed. Extensions are called from several
+     * threads at once only if they declare themselves thread safe (see
+     * ":ref:`thread-safety`"), calls to other extensions are serialized. The
+     * pointers returned should not be managed by the application.
+     * 
+     * @endrst
+     * 
+     * @param paths paths to documents
+     * 
+     * @return pointers to document trees
+     */
+    std::vector<const doc_tree_node*> get_doc_trees(std::vector<std::filesystem::path> paths);
+
+    /**
+     * @brief Returns a pointer to document tree of a path parsed by given extension
+     * 
+     * @details @rst
+     * 
+     * This function is same as :cpp:func:`docview::get_doc_tree`, except that
+     * only the extension loaded from ``extension`` is tried, regardless of
+     * applicability levels. Returns ``nullptr`` if the extension couldn't
+     * parse the path.
+     * 
+     * @endrst
+     * 
+     * @param path path to documents
+     * @param extension path to a loaded extension
+     * 
+     * @throw std::runtime_error if given path doesn't exist
+     * 
+     * @throw std::invalid_argument if extension at given path isn't loaded
+     * 
+     * @return pointer to document tree
+     */
+    const doc_tree_node* get_doc_tree(std::filesystem::path path, std::filesystem::path extension);
+
+    /**
+     * @brief Returns all files and directories under a directory, which might be documents
+     * 
+     * @details @rst
+     * 
+     * This function walks ``directory`` recursively and returns paths of all
+     * regular files and directories found, sorted. Entries directly inside
+     * ``directory`` are at depth 1, subdirectories are walked until
+     * ``max_depth`` is reached, or without a limit if ``max_depth`` is zero.
+     * Symbolic links are followed, but a directory is never walked twice, so
+     * symbolic link cycles are harmless. Subdirectories are walked in
+     * parallel. Unreadable directories are silently skipped.
+     * 
+     * @endrst
+     * 
+     * @param directory the directory to walk
+     * @param max_depth maximum depth to walk, zero for unlimited
+     * 
+     * @return paths of files and directories
+     */
+    std::vector<std::filesystem::path> find_documents(std::filesystem::path directory, unsigned int max_depth);
+
+    /**
+     * @brief Releases a document tree, which is no longer needed
+     * 
+     * @details @rst
+     * 
+     * This function makes libdocview forget the document tree with given root,
+     * so it won't appear in search results anymore and it's nodes become
+     * invalid. Memory used by the tree is still managed by the extension,
+     * except the copy of a tree of an extension written in C, which is freed.
+     * If the root is unknown, there are no effects.
+     * 
+     * @endrst
+     * 
+     * @param root root node of document tree
+     */
+    void release_doc_tree(const doc_tree_node* root);
+
+    /**
+     * @brief Returns the path of extension which owns a node
+     * 
+     * @details @rst
+     * 
+     * This function returns the path of extension which parsed the document
+     * tree containing ``node``.
+     * 
+     * @endrst
+     * 
+     * @param node pointer to a valid node in document tree
+     * 
+     * @throw std::invalid_argument if the node isn't valid
+     * 
+     * @return path to extension
+     */
+    std::filesystem::path get_owner(const doc_tree_node* node);
+
+    /**
+     * @brief Returns the paths of extensions which own several nodes
+     * 
+     * @details @rst
+     * 
+     * This function returns the same as calling :cpp:func:`get_owner` for
+     * every node, but looks up loaded trees and extensions once for all nodes,
+     * so that finding owners of all roots takes linear time.
+     * 
+     * @endrst
+     * 
+     * @param nodes pointers to valid nodes in document trees
+     * 
+     * @throw std::invalid_argument if any node isn't valid
+     * 
+     * @return paths to extensions, in the same order as nodes
+     */
+    std::vector<std::filesystem::path> get_owners(std::vector<const doc_tree_node*> nodes);
+
     /**
      * @brief Returns the URI or HTML content of document
      * 
@@ -414,9 +551,10 @@ namespace docview
      * @endrst
      * 
      * @param node pointer to a node in document tree
+     * @param section the name of section
      * @return details of from document
      */
-    std::string section(const doc_tree_node* node) noexcept;
+    std::string section(const doc_tree_node* node, std::string section);
 
     /**
      * @brief Searches through all loaded document trees
@@ -460,6 +598,138 @@ namespace docview
         std::vector<std::pair<const docview::doc_tree_node*, std::filesystem::path>> document_roots
     );
 
+    /**
+     * @brief Finds nodes whose title or any synonym is exactly given name
+     * 
+     * @details @rst
+     * 
+     * This function answers exact queries (e.g. "go to definition") from a hash
+     * index of titles and synonyms of all loaded document trees, without
+     * walking the trees. A name defined in several documents gives several
+     * nodes, in the order their trees were parsed. Trees parsed since the last
+     * lookup are indexed by the next lookup.
+     * 
+     * @endrst
+     * 
+     * @param name the exact title or synonym
+     * @return vector with matched document nodes
+     */
+    std::vector<const doc_tree_node*> lookup(std::string name);
+
+    /**
+     * @brief Finds nodes whose title or any synonym contains given query
+     * 
+     * @details @rst
+     * 
+     * This function finds nodes by any part of their name (e.g. ``show_all``
+     * matches ``gtk_widget_show_all``), using a trigram index of titles and
+     * synonyms of all loaded document trees. Only titles and synonyms having
+     * all trigrams of the query are compared with the query, queries shorter
+     * than three characters are compared with every distinct title and
+     * synonym. Returned vector does not have any particular order.
+     * 
+     * @endrst
+     * 
+     * @param query the search query
+     * @return vector with matched document nodes
+     */
+    std::vector<const doc_tree_node*> search_substring(std::string query);
+
+    /**
+     * @brief Finds nodes whose title or any synonym is within given edit distance of query
+     * 
+     * @details @rst
+     * 
+     * This function finds nodes despite typos in the query. A title or synonym
+     * matches if it can be turned into the query by inserting, deleting or
+     * replacing at most ``max_distance`` bytes (e.g. ``gtk_widgte_show``
+     * matches ``gtk_widget_show`` with distance 2). Sorted titles and synonyms
+     * are walked like a trie, and every prefix which can't be within the
+     * distance is skipped with all titles and synonyms starting with it, so
+     * small distances like 1 or 2 are fast, larger ones approach comparing the
+     * query with every title. Nearer nodes come first.
+     * 
+     * @endrst
+     * 
+     * @param query the search query
+     * @param max_distance maximum edit distance
+     * @return vector with matched document nodes
+     */
+    std::vector<const doc_tree_node*> search_fuzzy(std::string query, unsigned int max_distance);
+
+    /**
+     * @brief Finds nodes whose title or any synonym matches a regular expression
+     * 
+     * @details @rst
+     * 
+     * This function finds nodes with a pattern like ``^g_.*_free$``. Supported
+     * syntax is ``.``, bracket expressions (``[a-z_]``, ``[^0-9]``), ``\d``,
+     * ``\w``, ``\s`` and their negations, anchors ``^`` and ``$``, ``*``,
+     * ``+``, ``?``, ``|`` and groups. A match might be anywhere in title unless
+     * anchored. Other characters, and any character escaped with backslash,
+     * match themselves. Groups can be nested up to 256 levels deep.
+     * 
+     * Literals every match must contain are looked up in the trigram index, or
+     * if there are no such literals, the anchored prefix in sorted titles, and
+     * only titles and synonyms found are matched with a DFA built lazily from
+     * the pattern. Returned vector does not have any particular order.
+     * 
+     * @endrst
+     * 
+     * @param pattern the regular expression
+     * @return vector with matched document nodes
+     * 
+     * @throw std::invalid_argument if the pattern is invalid
+     */
+    std::vector<const doc_tree_node*> search_regex(std::string pattern);
+
+    /**
+     * @brief Searches for nodes scoped by names of their ancestors
+     * 
+     * @details @rst
+     * 
+     * This function searches with queries like ``Window::set_title`` or
+     * ``gtk > Window > set``. The query is split at ``::``, or at ``>`` if it
+     * has no ``::``, and spaces around the parts are ignored. The last part
+     * matches like :cpp:func:`docview::search`, i.e. title or any synonym must
+     * start with it. Every other part must be the exact title or a synonym of
+     * an ancestor, in the same order from root to the node, but other ancestors
+     * might be between them (e.g. ``gtk > set_title`` matches
+     * ``gtk > Window > set_title``).
+     * 
+     * Candidates are found from the index by the last part, then their
+     * ancestors are checked, so no tree is walked. Returned vector does not
+     * have any particular order.
+     * 
+     * @endrst
+     * 
+     * @param query the search query
+     * @return vector with matched document nodes
+     */
+    std::vector<const doc_tree_node*> search_path(std::string query);
+
+    /**
+     * @brief Searches through the subtree of a node
+     * 
+     * @details @rst
+     * 
+     * This function searches like :cpp:func:`docview::search`, but only
+     * through the given node and it's descendants (e.g. one book or one class
+     * of a large reference). Every indexed node has pre-order and post-order
+     * numbers, kept inside the library, so a match from the index is checked
+     * to be in the subtree in constant time, without walking the subtree.
+     * Returned vector does not have any particular order.
+     * 
+     * @endrst
+     * 
+     * @param node pointer to a node in document tree
+     * @param query the search query
+     * @return vector with matched document nodes
+     * 
+     * @throw std::invalid_argument if the node isn't in a loaded document tree
+     */
+    std::vector<const doc_tree_node*> search_within(const doc_tree_node* node, std::string query);
+
     /**
      * @brief Checks whether a document node is still valid
      * 
@@ -476,6 +746,426 @@ namespace docview
      * @return whether a document node is valid
      */
     bool validate(const doc_tree_node* node);
+
+    /**
+     * @brief Returns the recorded trace in Chrome trace event format
+     * 
+     * @details @rst
+     * 
+     * This function returns a JSON object with an array ``traceEvents``, which
+     * can be opened with ``chrome://tracing`` or Perfetto. Every call to the
+     * public API and every call to an extension is recorded as a complete
+     * event, only recent events of each thread are kept.
+     * 
+     * Trace points are only compiled when libdocview is configured with
+     * ``--enable-tracing``, otherwise the array is always empty. If the
+     * environment variable ``DOCVIEW_TRACE_FILE`` is set, the trace is written
+     * to that file when libdocview is unloaded.
+     * 
+     * @endrst
+     * 
+     * @return trace as JSON
+     */
+    std::string export_trace();
+
+    /**
+     * @brief Structure for holding a snapshot of runtime statistics
+     * 
+     */
+    struct statistics
+    {
+        /**
+         * @brief Number of loaded extensions
+         * 
+         */
+        unsigned long loaded_extensions;
+
+        /**
+         * @brief Number of loaded extensions which declared themselves thread safe
+         * 
+         */
+        unsigned long thread_safe_extensions;
+
+        /**
+         * @brief Number of loaded extensions written in C
+         * 
+         */
+        unsigned long c_extensions;
+
+        /**
+         * @brief Number of live document trees
+         * 
+         */
+        unsigned long roots;
+
+        /**
+         * @brief Number of nodes in live document trees
+         * 
+         */
+        unsigned long nodes;
+
+        /**
+         * @brief Number of nodes mirrored from extensions written in C, including released trees
+         * 
+         */
+        unsigned long c_extension_nodes;
+
+        /**
+         * @brief Number of lookups of original nodes of extensions written in C, which succeeded
+         * 
+         */
+        unsigned long c_extension_lookup_hits;
+
+        /**
+         * @brief Number of lookups of original nodes of extensions written in C, which failed
+         * 
+         */
+        unsigned long c_extension_lookup_misses;
+
+        /**
+         * @brief Number of worker threads in thread pool
+         * 
+         */
+        unsigned long pool_threads;
+
+        /**
+         * @brief Number of tasks waiting in thread pool queues
+         * 
+         */
+        unsigned long pool_queued_tasks;
+
+        /**
+         * @brief Number of tasks run by thread pool
+         * 
+         */
+        unsigned long pool_tasks_run;
+
+        /**
+         * @brief Number of tasks stolen by idle workers from other workers
+         * 
+         */
+        unsigned long pool_tasks_stolen;
+
+        /**
+         * @brief Generation of the last shared index published by this process, 0 if none
+         * 
+         */
+        unsigned long shared_index_generation;
+
+        /**
+         * @brief Size of the last shared index published by this process, in bytes
+         * 
+         */
+        unsigned long shared_index_bytes;
+
+        /**
+         * @brief Number of distinct titles and synonyms in the lookup index
+         * 
+         */
+        unsigned long index_terms;
+
+        /**
+         * @brief Number of distinct trigrams in the substring search index
+         * 
+         */
+        unsigned long index_trigrams;
+
+        /**
+         * @brief Number of document trees added but not indexed yet, they are indexed on next lookup
+         * 
+         */
+        unsigned long index_pending_roots;
+
+        /**
+         * @brief Number of lookups in the index
+         * 
+         */
+        unsigned long index_lookups;
+    };
+
+    /**
+     * @brief Returns a snapshot of runtime statistics
+     * 
+     * @details @rst
+     * 
+     * This function returns counters describing the state of libdocview, like
+     * loaded extensions, live document trees and the thread pool. Counters of
+     * events (e.g. lookups, tasks run) are cumulative since libdocview was
+     * loaded, the rest are current values. Counting nodes walks all trees, so
+     * it shouldn't be called in hot paths.
+     * 
+     * @endrst
+     * 
+     * @return statistics
+     */
+    statistics stats();
+
+    /**
+     * @brief Structure for holding allocation counts of a function or subsystem
+     * 
+     */
+    struct allocation_count
+    {
+
+        /**
+         * @brief Name of the public API function or internal subsystem
+         * 
+         */
+        std::string name;
+
+        /**
+         * @brief Whether it's a public API function
+         * 
+         */
+        bool api;
+
+        /**
+         * @brief Number of allocations made
+         * 
+         */
+        unsigned long allocations;
+
+        /**
+         * @brief Number of bytes allocated
+         * 
+         */
+        unsigned long bytes;
+    };
+
+    /**
+     * @brief Returns the number of allocations made by libdocview
+     * 
+     * @details @rst
+     * 
+     * This function returns allocation counts of every public API function
+     * (e.g. ``docview::search``, ``docview_search``) and internal subsystem
+     * (e.g. ``search_node``, ``extension``) called till now. An allocation is
+     * charged to the innermost API function and the innermost subsystem it was
+     * made in, including allocations made by extensions and by worker threads on
+     * behalf of the caller. Frees are not counted.
+     * 
+     * Counting is only compiled when libdocview is configured with
+     * ``--enable-allocation-accounting``, otherwise the vector is always empty.
+     * It replaces the global ``operator new`` of the whole process.
+     * 
+     * @endrst
+     * 
+     * @return allocation counts
+     */
+    std::vector<allocation_count> get_allocation_counts();
+
+    /**
+     * @brief Resets all allocation counts to zero
+     * 
+     */
+    void reset_allocation_counts();
+
+    /**
+     * @brief Publishes all live document trees as a shared index
+     * 
+     * @details @rst
+     * 
+     * This function flattens all live document trees, with their titles,
+     * synonyms and a sorted search index, into a read only POSIX shared memory
+     * object, which other processes can map and query with
+     * :cpp:class:`docview::shared_index` without loading any extension or
+     * parsing any document.
+     * 
+     * An index consists of a control object named ``/<name>`` and a data object
+     * per generation named ``/<name>.<generation>``. Every call writes a new
+     * generation, then atomically swaps the generation in the control object
+     * and unlinks the previous one. Readers which mapped an older generation
+     * keep it till they refresh. Only one process can publish at a time, other
+     * publishers wait for it. The name must not contain ``/``.
+     * 
+     * @endrst
+     * 
+     * @param name name of the index
+     * @return generation of the published index
+     * 
+     * @throw std::invalid_argument if the name isn't valid
+     * 
+     * @throw std::runtime_error if the shared memory couldn't be written
+     */
+    unsigned long publish_shared_index(std::string name);
+
+    /**
+     * @brief Removes a shared index published by any process
+     * 
+     * @details @rst
+     * 
+     * This function unlinks the control object and the current generation of
+     * a shared index. Readers which have already mapped it can use it till they
+     * destroy their :cpp:class:`docview::shared_index`. If there is no such
+     * index, there are no effects.
+     * 
+     * @endrst
+     * 
+     * @param name name of the index
+     * 
+     * @throw std::invalid_argument if the name isn't valid
+     */
+    void unpublish_shared_index(std::string name);
+
+    /**
+     * @brief Read only view of a shared index published by any process
+     * 
+     * @details @rst
+     * 
+     * This class maps a shared index published with
+     * :cpp:func:`docview::publish_shared_index` and queries it in place. Nodes
+     * are identified by their number, from 0 to ``size() - 1``, numbers are
+     * stable only within a generation. Roots are numbered first and children
+     * of a node have consecutive numbers.
+     * 
+     * The view stays on it's generation till :cpp:func:`refresh` is called. An
+     * object can be queried from several threads at once, but not while it's
+     * being refreshed.
+     * 
+     * @endrst
+     * 
+     */
+    class shared_index
+    {
+    private:
+
+        // Name of the index
+        std::string name;
+
+        // Mapped control object
+        void* control;
+
+        // Mapped data object of current generation
+        void* data;
+
+        // Size of data object
+        unsigned long data_size;
+
+        // Current generation
+        unsigned long current_generation;
+
+    public:
+
+        /**
+         * @brief Node number returned when there is no node
+         * 
+         */
+        static constexpr unsigned long npos = (unsigned long)-1;
+
+        /**
+         * @brief Maps the current generation of a shared index
+         * 
+         * @param name name of the index
+         * 
+         * @throw std::invalid_argument if the name isn't valid
+         * 
+         * @throw std::runtime_error if there is no valid index with given name
+         */
+        shared_index(std::string name);
+
+        shared_index(const shared_index& other) = delete;
+        shared_index& operator = (const shared_index& other) = delete;
+
+        /**
+         * @brief Unmaps the index
+         * 
+         */
+        ~shared_index();
+
+        /**
+         * @brief Maps the latest generation, if it's newer than the current one
+         * 
+         * @details @rst
+         * 
+         * Node numbers of the old generation mustn't be used after the view is
+         * refreshed.
+         * 
+         * @endrst
+         * 
+         * @return whether a newer generation was mapped
+         * 
+         * @throw std::runtime_error if the new generation couldn't be mapped or
+         * is corrupt
+         */
+        bool refresh();
+
+        /**
+         * @brief Returns the generation currently mapped
+         * 
+         * @return generation
+         */
+        unsigned long generation() const;
+
+        /**
+         * @brief Returns the number of nodes
+         * 
+         * @return number of nodes
+         */
+        unsigned long size() const;
+
+        /**
+         * @brief Returns the root nodes
+         * 
+         * @return vector of root nodes
+         */
+        std::vector<unsigned long> roots() const;
+
+        /**
+         * @brief Searches for nodes whose title or any synonym starts with given query
+         * 
+         * @details @rst
+         * 
+         * This function finds the same nodes as :cpp:func:`docview::search` did
+         * in the publishing process, with a binary search over the sorted titles
+         * and synonyms. Nodes are returned in ascending order of their number.
+         * 
+         * @endrst
+         * 
+         * @param query search query
+         * @return vector of matching nodes
+         */
+        std::vector<unsigned long> search(std::string query) const;
+
+        /**
+         * @brief Returns the title of a node
+         * 
+         * @param node node number
+         * @return title
+         * 
+         * @throw std::invalid_argument if there is no such node
+         */
+        std::string title(unsigned long node) const;
+
+        /**
+         * @brief Returns synonyms of title of a node
+         * 
+         * @param node node number
+         * @return vector of synonyms
+         * 
+         * @throw std::invalid_argument if there is no such node
+         */
+        std::vector<std::string> synonyms(unsigned long node) const;
+
+        /**
+         * @brief Returns the parent of a node, npos if it's a root
+         * 
+         * @param node node number
+         * @return parent
+         * 
+         * @throw std::invalid_argument if there is no such node
+         */
+        unsigned long parent(unsigned long node) const;
+
+        /**
+         * @brief Returns the children of a node
+         * 
+         * @param node node number
+         * @return vector of children
+         * 
+         * @throw std::invalid_argument if there is no such node
+         */
+        std::vector<unsigned long> children(unsigned long node) const;
+    };
 }
 
 #endif
@@ -25,10 +25,344 @@
 #include <memory>
 #include <functional>
 #include <stdexcept>
+#include <exception>
 #include <map>
 #include <array>
+#include <bitset>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <atomic>
+#include <thread>
+#include <deque>
+#include <algorithm>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
 #include <cstring>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <chrono>
+#include <sstream>
+#include <fstream>
+#include <string_view>
 #include <dlfcn.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/file.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <new>
+
+#define DOCVIEW_TRACE_CONCAT_(a, b) a##b
+#define DOCVIEW_TRACE_CONCAT(a, b) DOCVIEW_TRACE_CONCAT_(a, b)
+
+#ifdef DOCVIEW_TRACING
+
+// An event recorded by a trace point, times are in nanoseconds since the library was loaded
+struct trace_event
+{
+
+    // Number of the event plus one, zero while it's being written, readers check it before and after reading
+    std::atomic<unsigned long> sequence;
+
+    // Fields are atomic only to make reading while the owner writes well defined, sequence tells if they tore
+    std::atomic<const char*> name;
+    std::atomic<std::uint64_t> begin;
+    std::atomic<std::uint64_t> duration;
+};
+
+// Ring buffer of trace events of a thread, only the owner thread writes to it, so no locks are needed
+class trace_buffer
+{
+public:
+
+    // Number of events kept, older events are overwritten
+    static constexpr unsigned long capacity = 1 << 16;
+
+    // The events, event number n is stored at n % capacity
+    std::array<trace_event, capacity> events;
+
+    // Number of events recorded till now, published after the event is written
+    std::atomic<unsigned long> count;
+
+    // Sequential id of the thread, used as tid in exported trace
+    unsigned long thread_id;
+
+    trace_buffer(unsigned long thread_id)
+        : events(),
+        count(0),
+        thread_id(thread_id)
+    {
+    }
+
+    // Records an event, must be called only by the owner thread
+    void record(const char* name, std::uint64_t begin, std::uint64_t duration)
+    {
+        unsigned long index = count.load(std::memory_order_relaxed);
+        trace_event& event = events[index % capacity];
+        // Fields are stored with release ordering, so a reader seeing any of them sees the zeroed sequence too
+        event.sequence.store(0, std::memory_order_relaxed);
+        event.name.store(name, std::memory_order_release);
+        event.begin.store(begin, std::memory_order_release);
+        event.duration.store(duration, std::memory_order_release);
+        event.sequence.store(index + 1, std::memory_order_release);
+        count.store(index + 1, std::memory_order_release);
+    }
+
+    // Reads an event, returns false if it's overwritten or being written, can be called by any thread
+    bool read(unsigned long index, const char*& name, std::uint64_t& begin, std::uint64_t& duration) const
+    {
+        const trace_event& event = events[index % capacity];
+        if (event.sequence.load(std::memory_order_acquire) != index + 1)
+            return false;
+        name = event.name.load(std::memory_order_acquire);
+        begin = event.begin.load(std::memory_order_acquire);
+        duration = event.duration.load(std::memory_order_acquire);
+        return event.sequence.load(std::memory_order_relaxed) == index + 1;
+    }
+};
+
+// Time when the library was loaded, the origin of trace timestamps
+static const std::chrono::steady_clock::time_point trace_epoch = std::chrono::steady_clock::now();
+
+// Buffers of all threads which have ever recorded an event, buffers outlive their threads
+static std::vector<std::shared_ptr<trace_buffer>> trace_buffers;
+
+// Mutex guarding trace_buffers, taken only once per thread and during export
+static std::mutex trace_buffers_mutex;
+
+// Returns the buffer of calling thread, creating it on first call
+trace_buffer& current_trace_buffer()
+{
+    thread_local std::shared_ptr<trace_buffer> buffer;
+    if (!buffer)
+    {
+        std::lock_guard<std::mutex> lock(trace_buffers_mutex);
+        buffer = std::make_shared<trace_buffer>(trace_buffers.size() + 1);
+        trace_buffers.push_back(buffer);
+    }
+    return *buffer;
+}
+
+// Records an event spanning the lifetime of the object
+class trace_scope
+{
+private:
+
+    // Name of the event, must be a string literal
+    const char* name;
+
+    // Time when the scope was entered
+    std::chrono::steady_clock::time_point begin;
+
+public:
+
+    trace_scope(const char* name)
+        : name(name),
+        begin(std::chrono::steady_clock::now())
+    {
+    }
+
+    ~trace_scope()
+    {
+        auto end = std::chrono::steady_clock::now();
+        current_trace_buffer().record(
+            name,
+            std::chrono::duration_cast<std::chrono::nanoseconds>(begin - trace_epoch).count(),
+            std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()
+        );
+    }
+};
+
+// Writes the trace to the file named by DOCVIEW_TRACE_FILE when the library is unloaded
+static struct trace_file_writer
+{
+    ~trace_file_writer()
+    {
+        const char* trace_file = std::getenv("DOCVIEW_TRACE_FILE");
+        if (trace_file && *trace_file)
+            std::ofstream(trace_file) << docview::export_trace();
+    }
+} trace_file_writer;
+
+#define DOCVIEW_TRACE(name) trace_scope DOCVIEW_TRACE_CONCAT(trace_scope_, __LINE__)(name)
+
+#else
+
+// Tracing is disabled, trace points compile to nothing
+#define DOCVIEW_TRACE(name)
+
+#endif
+
+#ifdef DOCVIEW_ALLOCATION_ACCOUNTING
+
+// Allocation counts of a public API function or an internal subsystem
+struct allocation_counter
+{
+
+    // Name of the function or subsystem, must be a string literal
+    const char* name;
+
+    // Whether it's a public API function
+    bool api;
+
+    // Number of allocations and bytes allocated
+    std::atomic<unsigned long> allocations;
+    std::atomic<unsigned long> bytes;
+
+    allocation_counter(const char* name, bool api);
+};
+
+// All counters, never destroyed as operator new might be called during static destruction
+std::vector<allocation_counter*>& allocation_counters()
+{
+    static std::vector<allocation_counter*>* counters = new std::vector<allocation_counter*>;
+    return *counters;
+}
+
+// Mutex guarding allocation_counters()
+std::mutex& allocation_counters_mutex()
+{
+    static std::mutex* mutex = new std::mutex;
+    return *mutex;
+}
+
+allocation_counter::allocation_counter(const char* name, bool api)
+    : name(name),
+    api(api),
+    allocations(0),
+    bytes(0)
+{
+    std::lock_guard<std::mutex> lock(allocation_counters_mutex());
+    allocation_counters().push_back(this);
+}
+
+// Counters allocations of a thread are charged to, plain pointers so that no TLS initialization is needed
+struct allocation_context
+{
+    allocation_counter* api;
+    allocation_counter* subsystem;
+};
+
+thread_local allocation_context current_allocation_context = {nullptr, nullptr};
+
+// Charges allocations of the thread to a counter during the lifetime of the object
+class allocation_scope
+{
+private:
+
+    // Context to restore on destruction
+    allocation_context saved;
+
+public:
+
+    allocation_scope(allocation_counter& counter)
+        : saved(current_allocation_context)
+    {
+        if (counter.api)
+            current_allocation_context.api = &counter;
+        else
+            current_allocation_context.subsystem = &counter;
+    }
+
+    allocation_scope(allocation_context context)
+        : saved(current_allocation_context)
+    {
+        current_allocation_context = context;
+    }
+
+    ~allocation_scope()
+    {
+        current_allocation_context = saved;
+    }
+};
+
+// Charges an allocation to the current counters
+void count_allocation(std::size_t size)
+{
+    allocation_context& context = current_allocation_context;
+    if (context.api)
+    {
+        context.api->allocations.fetch_add(1, std::memory_order_relaxed);
+        context.api->bytes.fetch_add(size, std::memory_order_relaxed);
+    }
+    if (context.subsystem)
+    {
+        context.subsystem->allocations.fetch_add(1, std::memory_order_relaxed);
+        context.subsystem->bytes.fetch_add(size, std::memory_order_relaxed);
+    }
+}
+
+// Replacements of global allocation functions, allocations outside of any scope aren't counted
+void* operator new(std::size_t size)
+{
+    count_allocation(size);
+    void* pointer = std::malloc(size ? size : 1);
+    if (!pointer)
+        throw std::bad_alloc();
+    return pointer;
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    count_allocation(size);
+    return std::malloc(size ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return operator new(size, std::nothrow);
+}
+
+void operator delete(void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+#define DOCVIEW_ALLOCATION_SCOPE(name, api) \
+    static allocation_counter DOCVIEW_TRACE_CONCAT(allocation_counter_, __LINE__)(name, api); \
+    allocation_scope DOCVIEW_TRACE_CONCAT(allocation_scope_, __LINE__)( \
+        DOCVIEW_TRACE_CONCAT(allocation_counter_, __LINE__) \
+    )
+
+#else
+
+// Allocation accounting is disabled, scopes compile to nothing
+#define DOCVIEW_ALLOCATION_SCOPE(name, api)
+
+#endif
+
+// Marks the entry of a public API function
+#define DOCVIEW_API_CALL(name) DOCVIEW_TRACE(name); DOCVIEW_ALLOCATION_SCOPE(name, true)
+
+// Marks a call to an extension
+#define DOCVIEW_EXTENSION_CALL(name) DOCVIEW_TRACE(name); DOCVIEW_ALLOCATION_SCOPE("extension", false)
+
+// Marks an internal subsystem, for allocation accounting
+#define DOCVIEW_SUBSYSTEM(name) DOCVIEW_ALLOCATION_SCOPE(name, false)
 
 // Class for libdl, automatically frees up memory on destruction
 class dl_ptr
@@ -44,10 +378,18 @@ public:
     // Pointer to extension object by this extension
     docview::extension* extension;
 
+    // Mutex serializing calls to the extension
+    std::shared_ptr<std::mutex> call_mutex;
+
+    // Whether the extension declared itself thread safe
+    bool thread_safe;
+
     dl_ptr(std::filesystem::path path, int flags = RTLD_NOW | RTLD_LOCAL)
         : handle(dlopen(std::string(path).c_str(), flags)),
         path(path),
-        extension(nullptr)
+        extension(nullptr),
+        call_mutex(std::make_shared<std::mutex>()),
+        thread_safe(false)
     {}
 
     // We don't want to copy it, so delete copy constructor and define move contructor
@@ -57,13 +399,17 @@ public:
         handle = other.handle;
         path = other.path;
         extension = other.extension;
+        call_mutex = other.call_mutex;
+        thread_safe = other.thread_safe;
         ((dl_ptr*)(void*)&other)->handle = nullptr;
         return *this;
     }
     dl_ptr(dl_ptr&& other)
         : handle(other.handle),
         path(other.path),
-        extension(other.extension)
+        extension(other.extension),
+        call_mutex(other.call_mutex),
+        thread_safe(other.thread_safe)
     {
         other.handle = nullptr;
     }
@@ -78,168 +424,1683 @@ public:
     }
 };
 
-// Wrapper class for extensions written in C
-class c_extension : public docview::extension
+// Thread pool where idle threads steal tasks queued to busy ones
+class work_stealing_pool
 {
-private:
+public:
 
-    // Original functions defined by defined by extension
-    std::function<docview_extension_applicability_level()> func_applicability_level;
-    std::function<const docview_extension_doc_tree_node*(const char*)> func_get_docs_tree;
-    std::function<docview_document(const docview_extension_doc_tree_node*)> func_get_doc;
-    std::function<const char*(const docview_extension_doc_tree_node*)> func_get_brief;
-    std::function<const char*(const docview_extension_doc_tree_node*)> func_get_details;
-    std::function<const char*(const docview_extension_doc_tree_node*, const char*)> func_get_section;
+    // Set of tasks which can be waited for together
+    class task_group
+    {
+    private:
 
-    // All root nodes created by the this class
-    std::vector<const docview::doc_tree_node*> root_nodes;
+        // Number of tasks of this group not finished yet
+        std::atomic<unsigned long> pending{0};
 
-    // Map of original node created by extension, mapped with nodes created by this class
-    std::map<const docview::doc_tree_node*, const docview_extension_doc_tree_node*> original_nodes;
+        // First exception thrown by a task of this group, rethrown by wait once all tasks finish
+        std::exception_ptr error;
+        std::mutex error_mutex;
 
-    // Builds a doc_tree from a C doc_tree
-    docview::doc_tree_node* build_doc_tree(
-        const docview_extension_doc_tree_node* source,
-        const docview::doc_tree_node* parent = nullptr
-    )
+        friend class work_stealing_pool;
+    };
+
+private:
+
+    // Task queue owned by a worker
+    struct task_queue
     {
+        std::mutex mutex;
+        std::deque<std::pair<std::function<void()>, task_group*>> tasks;
+    };
 
-        // If source is a nullptr, return a nullptr
-        if (!source) return nullptr;
+    // One queue per worker
+    std::vector<std::unique_ptr<task_queue>> queues;
 
-        // Allocate memory 
-        docview::doc_tree_node* node = new docview::doc_tree_node;
+    // The worker threads
+    std::vector<std::thread> workers;
 
-        // Set the parent
-        node->parent = parent;
+    // Number of tasks sitting in queues
+    std::atomic<unsigned long> queued{0};
 
-        // If there is no parents, add it to root nodes
-        if (!parent) root_nodes.push_back(node);
+    // Number of tasks run till now, and how many of them were stolen from other workers
+    std::atomic<unsigned long> run_count{0};
+    std::atomic<unsigned long> steal_count{0};
 
-        // Add it's information to original node map
-        original_nodes.insert(std::make_pair(node, source));
+    // Queue to use for next task submitted by a thread outside of pool
+    std::atomic<unsigned long> next_queue{0};
 
-        // Add all children
-        for (unsigned long i = 0; source->children[i]; i++)
+    // Mutex and condition variable to sleep on when there is nothing to do
+    std::mutex sleep_mutex;
+    std::condition_variable wake;
+
+    // Set on destruction
+    bool stopping = false;
+
+    // Index of the queue owned by the current thread, -1 for threads outside of pool
+    static thread_local long current_queue;
+
+    // Takes a task, from own queue's back first, then from other queues' front
+    bool take(std::pair<std::function<void()>, task_group*>& task)
+    {
+        if (current_queue >= 0)
         {
-            node->children.push_back(build_doc_tree(source->children[i], node));
+            task_queue& own = *queues[current_queue];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty())
+            {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                queued--;
+                return true;
+            }
         }
 
-        // Return created node
-        return node;
+        for (unsigned long i = 0; i < queues.size(); i++)
+        {
+            task_queue& victim = *queues[(current_queue + 1 + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty())
+            {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                queued--;
+                if (current_queue >= 0 && &victim != queues[current_queue].get())
+                    steal_count.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+
+        return false;
     }
 
-    // Frees memory allocated for nodes created by this class, not by extensions
-    void free_node(const docview::doc_tree_node* node)
+    // Runs a task and marks it finished, even if it throws, as other tasks might still use the waiter's data
+    void run(std::pair<std::function<void()>, task_group*>& task)
     {
-
-        // First delete all child nodes
-        for (auto child : node->children)
+        try
         {
-            free_node(child);
+            task.first();
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(task.second->error_mutex);
+            if (!task.second->error)
+                task.second->error = std::current_exception();
         }
+        run_count.fetch_add(1, std::memory_order_relaxed);
+        if (--task.second->pending == 0)
+        {
 
-        // Then delete the provided node
-        delete node;
+            // Wake up threads waiting for the group
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+            wake.notify_all();
+        }
+    }
+
+    // Main function of worker threads
+    void work(long index)
+    {
+        current_queue = index;
+        std::pair<std::function<void()>, task_group*> task;
+        while (true)
+        {
+            if (take(task))
+            {
+                run(task);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(sleep_mutex);
+            wake.wait(lock, [this]() { return stopping || queued > 0; });
+            if (stopping) return;
+        }
     }
 
 public:
 
-    // Constructs the object, throws on invalid input
-    c_extension(docview_extension_functions* functions)
-        : func_applicability_level(functions->applicability_level),
-        func_get_docs_tree(functions->func_get_docs_tree),
-        func_get_doc(functions->get_doc),
-        func_get_brief(functions->get_brief),
-        func_get_details(functions->get_details),
-        func_get_section(functions->get_section),
-        root_nodes{},
-        original_nodes{}
+    // Creates the pool with given number of threads
+    work_stealing_pool(unsigned long threads)
     {
-        if (!func_applicability_level || !func_get_docs_tree || !func_get_doc)
-            throw std::runtime_error("invalid functions pointers");
+        for (unsigned long i = 0; i < threads; i++)
+            queues.push_back(std::make_unique<task_queue>());
+        for (unsigned long i = 0; i < threads; i++)
+            workers.emplace_back(&work_stealing_pool::work, this, i);
     }
 
-    // Destructor, frees up all memory used
-    virtual ~c_extension() noexcept
+    // Stops and joins all workers
+    ~work_stealing_pool()
     {
-        for (auto node : root_nodes)
-            free_node(node);
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+            stopping = true;
+            wake.notify_all();
+        }
+        for (auto& worker : workers)
+            worker.join();
     }
 
-    // This function returns the applicability level of the extension
-    applicability_level get_applicability_level() noexcept
+    // Queues a task, tasks queued by workers stay in their own queue
+    void submit(task_group& group, std::function<void()> task)
     {
-        return (applicability_level)func_applicability_level();
+        group.pending++;
+
+#ifdef DOCVIEW_ALLOCATION_ACCOUNTING
+        // Charge allocations of the task to the counters of the submitter
+        task = [task = std::move(task), context = current_allocation_context]() -> void
+        {
+            allocation_scope scope(context);
+            task();
+        };
+#endif
+
+        task_queue& queue = *queues[
+            current_queue >= 0 ? current_queue : next_queue++ % queues.size()
+        ];
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.emplace_back(std::move(task), &group);
+            queued++;
+        }
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        wake.notify_one();
     }
 
-    // This function returns a document tree of given path
-    const docview::doc_tree_node* get_doc_tree(std::filesystem::path path) noexcept
+    // Waits until all tasks of a group finish, running queued tasks meanwhile, then rethrows the first exception
+    void wait(task_group& group)
     {
+        std::pair<std::function<void()>, task_group*> task;
+        while (group.pending > 0)
+        {
+            if (take(task))
+            {
+                run(task);
+                continue;
+            }
 
-        // Convert C nodes to C++ nodes and return
-        return build_doc_tree(func_get_docs_tree(std::string(path).c_str()));
+            std::unique_lock<std::mutex> lock(sleep_mutex);
+            wake.wait(lock, [&]() { return group.pending == 0 || queued > 0; });
+        }
+        if (group.error)
+            std::rethrow_exception(group.error);
     }
 
-    // This function returns the content or URI of a document node
-    std::pair<std::string, bool> get_doc(const docview::doc_tree_node* node) noexcept
+    // Returns the number of worker threads
+    unsigned long thread_count() const
     {
-        docview_document doc = func_get_doc(original_nodes[node]);
-        return std::make_pair(std::string(doc.content_or_uri), doc.is_uri);
+        return workers.size();
     }
 
-    // This function returns the brief of a document node
-    std::string brief(const docview::doc_tree_node* node) noexcept
+    // Returns the number of tasks waiting in queues
+    unsigned long queued_tasks() const
     {
+        return queued;
+    }
 
-        // If function is null, return empty string
-        if (func_get_brief)
-            return func_get_brief(original_nodes[node]);
-        return std::string();
+    // Returns the number of tasks run till now
+    unsigned long tasks_run() const
+    {
+        return run_count.load(std::memory_order_relaxed);
     }
 
-    // This function returns details from a document node
-    std::string details(const docview::doc_tree_node* node) noexcept
+    // Returns the number of tasks stolen by workers from other workers' queues
+    unsigned long tasks_stolen() const
     {
+        return steal_count.load(std::memory_order_relaxed);
+    }
 
-        // If function is null, return empty string
-        if (func_get_details)
-            return func_get_details(original_nodes[node]);
-        return std::string();
+    // Returns the pool shared by whole library, created on first use
+    static work_stealing_pool& shared()
+    {
+        static work_stealing_pool pool(std::max(1u, std::thread::hardware_concurrency()));
+        return pool;
+    }
+};
+
+thread_local long work_stealing_pool::current_queue = -1;
+
+// Walks directories recursively, subdirectories are walked in parallel on the pool
+class directory_walker
+{
+private:
+
+    // The pool to run on, and group of tasks started by this walker
+    work_stealing_pool& pool;
+    work_stealing_pool::task_group group;
+
+    // Maximum depth to walk, zero for unlimited
+    unsigned int max_depth;
+
+    // Mutex guarding visited and found
+    std::mutex mutex;
+
+    // Device and inode of walked directories, to not walk a directory twice through symlinks
+    std::set<std::pair<dev_t, ino_t>> visited;
+
+    // All regular files and directories found
+    std::vector<std::filesystem::path> found;
+
+    // Walks a directory, whose entries are at given depth
+    void walk(std::filesystem::path directory, unsigned int depth)
+    {
+        DOCVIEW_SUBSYSTEM("directory_walker");
+        DIR* dir = opendir(directory.c_str());
+        if (!dir) return;
+
+        // Skip directories walked already, this breaks symlink cycles
+        struct stat dir_stat;
+        if (fstat(dirfd(dir), &dir_stat) != 0)
+        {
+            closedir(dir);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!visited.insert(std::make_pair(dir_stat.st_dev, dir_stat.st_ino)).second)
+            {
+                closedir(dir);
+                return;
+            }
+        }
+
+        std::vector<std::filesystem::path> entries;
+        while (dirent* entry = readdir(dir))
+        {
+            if (std::strcmp(entry->d_name, ".") == 0 || std::strcmp(entry->d_name, "..") == 0)
+                continue;
+
+            // Use the type reported by readdir, stat only symlinks and unknown types
+            bool is_directory;
+            switch (entry->d_type)
+            {
+            case DT_REG:
+                is_directory = false;
+                break;
+
+            case DT_DIR:
+                is_directory = true;
+                break;
+
+            case DT_LNK:
+            case DT_UNKNOWN:
+            {
+
+                // Follow symlinks, skip broken ones
+                struct stat entry_stat;
+                if (fstatat(dirfd(dir), entry->d_name, &entry_stat, 0) != 0)
+                    continue;
+                if (S_ISREG(entry_stat.st_mode))
+                    is_directory = false;
+                else if (S_ISDIR(entry_stat.st_mode))
+                    is_directory = true;
+                else
+                    continue;
+                break;
+            }
+
+            // Devices, sockets and pipes can't be documents
+            default:
+                continue;
+            }
+
+            entries.push_back(directory / entry->d_name);
+
+            // Walk subdirectories in parallel, if not too deep
+            if (is_directory && (max_depth == 0 || depth < max_depth))
+                pool.submit(group, [this, path = entries.back(), depth]() -> void
+                {
+                    walk(path, depth + 1);
+                });
+        }
+        closedir(dir);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        found.insert(found.end(), entries.begin(), entries.end());
+    }
+
+public:
+
+    // Constructs the walker
+    directory_walker(work_stealing_pool& pool, unsigned int max_depth)
+        : pool(pool),
+        max_depth(max_depth)
+    {}
+
+    // Walks the directory and returns all entries found, sorted
+    std::vector<std::filesystem::path> run(std::filesystem::path directory)
+    {
+        pool.submit(group, [this, directory]() -> void
+        {
+            walk(directory, 1);
+        });
+        pool.wait(group);
+
+        std::sort(found.begin(), found.end());
+        return found;
+    }
+};
+
+// Wrapper class for extensions written in C
+class c_extension : public docview::extension
+{
+private:
+
+    // Original functions defined by defined by extension
+    std::function<docview_extension_applicability_level()> func_applicability_level;
+    std::function<const docview_extension_doc_tree_node*(const char*)> func_get_docs_tree;
+    std::function<docview_document(const docview_extension_doc_tree_node*)> func_get_doc;
+    std::function<const char*(const docview_extension_doc_tree_node*)> func_get_brief;
+    std::function<const char*(const docview_extension_doc_tree_node*)> func_get_details;
+    std::function<const char*(const docview_extension_doc_tree_node*, const char*)> func_get_section;
+
+    // All root nodes created by the this class
+    std::vector<const docview::doc_tree_node*> root_nodes;
+
+    // Map of original node created by extension, mapped with nodes created by this class
+    std::map<const docview::doc_tree_node*, const docview_extension_doc_tree_node*> original_nodes;
+
+    // Mutex guarding root_nodes and original_nodes
+    std::mutex nodes_mutex;
+
+    // Number of lookups in original_nodes which found and didn't find the node
+    std::atomic<unsigned long> lookup_hits{0};
+    std::atomic<unsigned long> lookup_misses{0};
+
+    // Returns the original node of a node created by this class
+    const docview_extension_doc_tree_node* get_original_node(const docview::doc_tree_node* node)
+    {
+        std::lock_guard<std::mutex> lock(nodes_mutex);
+        auto original = original_nodes.find(node);
+        if (original == original_nodes.end())
+        {
+            lookup_misses.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        lookup_hits.fetch_add(1, std::memory_order_relaxed);
+        return original->second;
+    }
+
+    // Builds a doc_tree from a C doc_tree
+    docview::doc_tree_node* build_doc_tree(
+        const docview_extension_doc_tree_node* source,
+        const docview::doc_tree_node* parent = nullptr
+    )
+    {
+
+        // If source is a nullptr, return a nullptr
+        if (!source) return nullptr;
+
+        // Allocate memory 
+        docview::doc_tree_node* node = new docview::doc_tree_node;
+
+        // Set the parent
+        node->parent = parent;
+
+        // Copy title and synonyms
+        node->title = source->title;
+        for (unsigned long i = 0; source->synonyms && source->synonyms[i]; i++)
+            node->synonyms.push_back(source->synonyms[i]);
+
+        // If there is no parents, add it to root nodes
+        if (!parent) root_nodes.push_back(node);
+
+        // Add it's information to original node map
+        original_nodes.insert(std::make_pair(node, source));
+
+        // Add all children
+        for (unsigned long i = 0; source->children[i]; i++)
+        {
+            node->children.push_back(build_doc_tree(source->children[i], node));
+        }
+
+        // Return created node
+        return node;
+    }
+
+    // Frees memory allocated for nodes created by this class, not by extensions
+    void free_node(const docview::doc_tree_node* node)
+    {
+
+        // First delete all child nodes
+        for (auto child : node->children)
+        {
+            free_node(child);
+        }
+
+        // Then delete the provided node
+        delete node;
+    }
+
+public:
+
+    // Constructs the object, throws on invalid input
+    c_extension(docview_extension_functions* functions)
+        : func_applicability_level(functions->applicability_level),
+        func_get_docs_tree(functions->func_get_docs_tree),
+        func_get_doc(functions->get_doc),
+        func_get_brief(functions->get_brief),
+        func_get_details(functions->get_details),
+        func_get_section(functions->get_section),
+        root_nodes{},
+        original_nodes{}
+    {
+        if (!func_applicability_level || !func_get_docs_tree || !func_get_doc)
+            throw std::runtime_error("invalid functions pointers");
+    }
+
+    // Destructor, frees up all memory used
+    virtual ~c_extension() noexcept
+    {
+        for (auto node : root_nodes)
+            free_node(node);
+    }
+
+    // This function returns the applicability level of the extension
+    applicability_level get_applicability_level() noexcept
+    {
+        return (applicability_level)func_applicability_level();
+    }
+
+    // Adds the number of nodes mirrored from the extension and node lookups to statistics
+    void add_stats(docview::statistics& stats)
+    {
+        std::lock_guard<std::mutex> lock(nodes_mutex);
+        stats.c_extension_nodes += original_nodes.size();
+        stats.c_extension_lookup_hits += lookup_hits.load(std::memory_order_relaxed);
+        stats.c_extension_lookup_misses += lookup_misses.load(std::memory_order_relaxed);
+    }
+
+    // Frees a document tree created by this class and forgets it's nodes, if it's not such a tree,
+    // there are no effects
+    void release_doc_tree(const docview::doc_tree_node* root)
+    {
+        std::lock_guard<std::mutex> lock(nodes_mutex);
+        auto root_node = std::find(root_nodes.begin(), root_nodes.end(), root);
+        if (root_node == root_nodes.end())
+            return;
+        root_nodes.erase(root_node);
+
+        // Forget every node of the tree, iteratively as trees might be deep
+        std::vector<const docview::doc_tree_node*> stack = {root};
+        while (!stack.empty())
+        {
+            const docview::doc_tree_node* node = stack.back();
+            stack.pop_back();
+            original_nodes.erase(node);
+            stack.insert(stack.end(), node->children.begin(), node->children.end());
+        }
+        free_node(root);
+    }
+
+    // This function returns a document tree of given path
+    const docview::doc_tree_node* get_doc_tree(std::filesystem::path path) noexcept
+    {
+
+        // Parse the document with the extension
+        const docview_extension_doc_tree_node* tree = func_get_docs_tree(std::string(path).c_str());
+
+        // Convert C nodes to C++ nodes and return
+        std::lock_guard<std::mutex> lock(nodes_mutex);
+        return build_doc_tree(tree);
+    }
+
+    // This function returns the content or URI of a document node
+    std::pair<std::string, bool> get_doc(const docview::doc_tree_node* node) noexcept
+    {
+        docview_document doc = func_get_doc(get_original_node(node));
+        return std::make_pair(std::string(doc.content_or_uri), doc.is_uri);
+    }
+
+    // This function returns the brief of a document node
+    std::string brief(const docview::doc_tree_node* node) noexcept
+    {
+
+        // If function is null, return empty string
+        if (func_get_brief)
+            return func_get_brief(get_original_node(node));
+        return std::string();
+    }
+
+    // This function returns details from a document node
+    std::string details(const docview::doc_tree_node* node) noexcept
+    {
+
+        // If function is null, return empty string
+        if (func_get_details)
+            return func_get_details(get_original_node(node));
+        return std::string();
     }
     
     // This function returns a section from a document node
     std::string section(const docview::doc_tree_node* node, std::string section) noexcept
     {
 
-        // If function is null, return empty string
-        if (func_get_section)
-            return func_get_section(original_nodes[node], section.c_str());
-        return std::string();
+        // If function is null, return empty string
+        if (func_get_section)
+            return func_get_section(get_original_node(node), section.c_str());
+        return std::string();
+    }
+};
+
+// Loaded library (aka extension)
+static std::vector<dl_ptr> loaded_libs;
+
+// Loaded extension objects
+static std::vector<docview::extension*> loaded_extensions;
+
+// Loaded C extension objects
+static std::vector<std::shared_ptr<docview::extension>> loaded_c_extensions;
+
+// All root nodes loaded till now, with the extension loaded it
+std::vector<std::pair<const docview::doc_tree_node*, docview::extension*>> root_nodes;
+
+// Mutex guarding loaded_libs, loaded_extensions and loaded_c_extensions
+static std::shared_mutex extensions_mutex;
+
+// Mutex guarding root_nodes
+static std::shared_mutex root_nodes_mutex;
+
+// Syntax tree of a regular expression
+struct regex_node
+{
+    enum class kind
+    {
+        bytes,
+        concat,
+        alternate,
+        star,
+        plus,
+        optional,
+        begin,
+        end
+    };
+
+    kind type;
+
+    // Bytes matched, only for bytes
+    std::bitset<256> set;
+
+    // Operands, none for bytes, begin and end
+    std::vector<regex_node> children;
+};
+
+// Parses a regular expression with ., [], [^], \d, \w, \s, ^, $, *, +, ?, | and (), throws on syntax errors
+class regex_parser
+{
+private:
+
+    // Maximum nesting of groups, parsing and compiling recurse once per level
+    static constexpr int max_depth = 256;
+
+    // The pattern, the position being parsed and the number of groups open there
+    std::string_view pattern;
+    std::size_t position;
+    int depth;
+
+    [[noreturn]] void fail(const std::string& message)
+    {
+        throw std::invalid_argument(
+            "invalid regular expression: " + message + " at " + std::to_string(position)
+        );
+    }
+
+    // Returns the set of an escape sequence like \d, position is after the backslash
+    std::bitset<256> escape()
+    {
+        if (position >= pattern.size())
+            fail("trailing backslash");
+        char c = pattern[position++];
+        std::bitset<256> set;
+        switch (c)
+        {
+        case 'd':
+        case 'D':
+            for (int byte = '0'; byte <= '9'; byte++)
+                set.set(byte);
+            break;
+        case 'w':
+        case 'W':
+            for (int byte = 0; byte < 256; byte++)
+                if (std::isalnum(byte) || byte == '_')
+                    set.set(byte);
+            break;
+        case 's':
+        case 'S':
+            for (char byte : std::string_view(" \t\n\r\f\v"))
+                set.set((unsigned char)byte);
+            break;
+        case 'n':
+            set.set('\n');
+            return set;
+        case 't':
+            set.set('\t');
+            return set;
+        default:
+            set.set((unsigned char)c);
+            return set;
+        }
+        return std::isupper((unsigned char)c) ? ~set : set;
+    }
+
+    // Parses a bracket expression, position is after the opening bracket
+    std::bitset<256> bracket()
+    {
+        std::bitset<256> set;
+        bool negated = position < pattern.size() && pattern[position] == '^';
+        if (negated)
+            position++;
+
+        // A closing bracket right after the opening one is a literal
+        bool first = true;
+        while (position < pattern.size() && (first || pattern[position] != ']'))
+        {
+            first = false;
+            std::bitset<256> item;
+            unsigned char low = pattern[position++];
+            if (low == '\\')
+            {
+                item = escape();
+                if (item.count() != 1)
+                {
+                    set |= item;
+                    continue;
+                }
+                for (int byte = 0; byte < 256; byte++)
+                    if (item.test(byte))
+                        low = byte;
+            }
+
+            // A range, unless the dash is the last character
+            if (position + 1 < pattern.size() && pattern[position] == '-' && pattern[position + 1] != ']')
+            {
+                unsigned char high = pattern[position + 1];
+                position += 2;
+                if (high == '\\')
+                {
+                    if (position >= pattern.size())
+                        fail("trailing backslash");
+                    high = pattern[position++];
+                }
+                if (high < low)
+                    fail("invalid range");
+                for (int byte = low; byte <= high; byte++)
+                    set.set(byte);
+            }
+            else
+                set.set(low);
+        }
+        if (position >= pattern.size())
+            fail("missing ]");
+        position++;
+        return negated ? ~set : set;
+    }
+
+    regex_node atom()
+    {
+        regex_node node = {regex_node::kind::bytes, {}, {}};
+        char c = pattern[position++];
+        switch (c)
+        {
+        case '(':
+            if (++depth > max_depth)
+                fail("groups nested too deeply");
+            node = alternation();
+            if (position >= pattern.size() || pattern[position] != ')')
+                fail("missing )");
+            position++;
+            depth--;
+            break;
+        case '[':
+            node.set = bracket();
+            break;
+        case '.':
+            node.set.set();
+            break;
+        case '^':
+            node.type = regex_node::kind::begin;
+            break;
+        case '$':
+            node.type = regex_node::kind::end;
+            break;
+        case '\\':
+            node.set = escape();
+            break;
+        case '*':
+        case '+':
+        case '?':
+            position--;
+            fail("nothing to repeat");
+        case ')':
+            position--;
+            fail("unmatched )");
+        default:
+            node.set.set((unsigned char)c);
+        }
+        return node;
+    }
+
+    regex_node repetition()
+    {
+        regex_node node = atom();
+        while (position < pattern.size() &&
+            (pattern[position] == '*' || pattern[position] == '+' || pattern[position] == '?'))
+        {
+            char c = pattern[position++];
+            regex_node::kind type = c == '*' ? regex_node::kind::star :
+                c == '+' ? regex_node::kind::plus : regex_node::kind::optional;
+
+            // Repeating a repetition doesn't nest, x** and x++ are x* and x+, other mixes like x+? are x*
+            if (node.type == regex_node::kind::star || node.type == regex_node::kind::plus ||
+                node.type == regex_node::kind::optional)
+            {
+                if (node.type != type)
+                    node.type = regex_node::kind::star;
+            }
+            else
+                node = {type, {}, {std::move(node)}};
+        }
+        return node;
+    }
+
+    regex_node concatenation()
+    {
+        regex_node node = {regex_node::kind::concat, {}, {}};
+        while (position < pattern.size() && pattern[position] != '|' && pattern[position] != ')')
+            node.children.push_back(repetition());
+        return node;
+    }
+
+    regex_node alternation()
+    {
+        regex_node node = {regex_node::kind::alternate, {}, {concatenation()}};
+        while (position < pattern.size() && pattern[position] == '|')
+        {
+            position++;
+            node.children.push_back(concatenation());
+        }
+        return node.children.size() == 1 ? std::move(node.children[0]) : std::move(node);
+    }
+
+public:
+
+    regex_parser(std::string_view pattern)
+        : pattern(pattern),
+        position(0),
+        depth(0)
+    {
+    }
+
+    regex_node parse()
+    {
+        regex_node node = alternation();
+        if (position < pattern.size())
+            fail("unmatched )");
+        return node;
+    }
+};
+
+// Collects literals every match must contain, and the literal every match must start with if anchored
+void required_literals(const regex_node& node, std::vector<std::string>& literals, std::string* prefix)
+{
+    switch (node.type)
+    {
+    case regex_node::kind::concat:
+    {
+
+        // Runs of single bytes are literals, a run right after ^ at start is the prefix
+        std::string run;
+        bool anchored = false;
+        for (std::size_t i = 0; i < node.children.size(); i++)
+        {
+            const regex_node& child = node.children[i];
+            if (child.type == regex_node::kind::bytes && child.set.count() == 1)
+            {
+                for (int byte = 0; byte < 256; byte++)
+                    if (child.set.test(byte))
+                        run += (char)byte;
+                continue;
+            }
+            if (!run.empty())
+            {
+                if (anchored && prefix)
+                    *prefix = run;
+                literals.push_back(run);
+                run.clear();
+            }
+            anchored = i == 0 && child.type == regex_node::kind::begin;
+            required_literals(child, literals, nullptr);
+        }
+        if (!run.empty())
+        {
+            if (anchored && prefix)
+                *prefix = run;
+            literals.push_back(run);
+        }
+        break;
+    }
+    case regex_node::kind::plus:
+        required_literals(node.children[0], literals, nullptr);
+        break;
+    case regex_node::kind::bytes:
+        if (node.set.count() == 1)
+            for (int byte = 0; byte < 256; byte++)
+                if (node.set.test(byte))
+                    literals.push_back(std::string(1, (char)byte));
+        break;
+    default:
+
+        // Alternatives and optional parts aren't required
+        break;
+    }
+}
+
+// Regular expression compiled to an NFA, which is turned into a DFA lazily while matching
+class regex_automaton
+{
+private:
+
+    // A state of NFA, bytes states consume a byte, the rest are epsilon moves
+    struct nfa_state
+    {
+        enum class kind
+        {
+            bytes,
+            split,
+            begin,
+            end,
+            accept
+        };
+
+        kind type;
+        std::bitset<256> set;
+        int out;
+        int out1;
+    };
+
+    // A state of DFA, a set of NFA states
+    struct dfa_state
+    {
+        std::vector<int> states;
+
+        // Whether it contains the accepting state, or it would if the input ended here
+        bool accepting;
+        bool accepting_at_end;
+
+        // Whether it can never reach the accepting state
+        bool dead;
+
+        // Next state for every byte, -1 if not computed yet
+        std::array<int, 256> next;
+    };
+
+    // Maximum number of cached DFA states, the cache is cleared if it grows beyond it
+    static constexpr std::size_t max_dfa_states = 4096;
+
+    std::vector<nfa_state> nfa;
+    int nfa_start;
+    std::vector<dfa_state> dfa;
+    std::map<std::vector<int>, int> dfa_ids;
+    int dfa_start;
+
+    // Checks whether every match of a syntax tree starts with ^, then it needn't be tried at every position
+    static bool anchored(const regex_node& node)
+    {
+        switch (node.type)
+        {
+        case regex_node::kind::begin:
+            return true;
+        case regex_node::kind::concat:
+            return !node.children.empty() && anchored(node.children[0]);
+        case regex_node::kind::alternate:
+            return std::all_of(node.children.begin(), node.children.end(), anchored);
+        default:
+            return false;
+        }
+    }
+
+    // Adds states leading from given syntax tree to state next, returns the first state
+    int compile(const regex_node& node, int next)
+    {
+        int state;
+        switch (node.type)
+        {
+        case regex_node::kind::bytes:
+            nfa.push_back({nfa_state::kind::bytes, node.set, next, -1});
+            return nfa.size() - 1;
+        case regex_node::kind::concat:
+            for (auto child = node.children.rbegin(); child != node.children.rend(); child++)
+                next = compile(*child, next);
+            return next;
+        case regex_node::kind::alternate:
+            state = compile(node.children.back(), next);
+            for (auto child = node.children.rbegin() + 1; child != node.children.rend(); child++)
+            {
+                int first = compile(*child, next);
+                nfa.push_back({nfa_state::kind::split, {}, first, state});
+                state = nfa.size() - 1;
+            }
+            return state;
+        case regex_node::kind::star:
+            nfa.push_back({nfa_state::kind::split, {}, -1, next});
+            state = nfa.size() - 1;
+            nfa[state].out = compile(node.children[0], state);
+            return state;
+        case regex_node::kind::plus:
+            nfa.push_back({nfa_state::kind::split, {}, -1, next});
+            state = nfa.size() - 1;
+            nfa[state].out = compile(node.children[0], state);
+            return nfa[state].out;
+        case regex_node::kind::optional:
+            state = compile(node.children[0], next);
+            nfa.push_back({nfa_state::kind::split, {}, state, next});
+            return nfa.size() - 1;
+        case regex_node::kind::begin:
+            nfa.push_back({nfa_state::kind::begin, {}, next, -1});
+            return nfa.size() - 1;
+        case regex_node::kind::end:
+            nfa.push_back({nfa_state::kind::end, {}, next, -1});
+            return nfa.size() - 1;
+        }
+        return next;
+    }
+
+    // Adds states reachable by epsilon moves, ^ is passed only at start and $ only at end
+    void closure(std::vector<int>& states, bool at_start, bool at_end)
+    {
+        std::vector<bool> seen(nfa.size());
+        std::vector<int> stack(states.begin(), states.end());
+        states.clear();
+        while (!stack.empty())
+        {
+            int state = stack.back();
+            stack.pop_back();
+            if (seen[state])
+                continue;
+            seen[state] = true;
+            switch (nfa[state].type)
+            {
+            case nfa_state::kind::split:
+                stack.push_back(nfa[state].out1);
+                stack.push_back(nfa[state].out);
+                break;
+            case nfa_state::kind::begin:
+                if (at_start)
+                    stack.push_back(nfa[state].out);
+                break;
+            case nfa_state::kind::end:
+
+                // Kept, so that it can be passed if input ends
+                states.push_back(state);
+                if (at_end)
+                    stack.push_back(nfa[state].out);
+                break;
+            default:
+                states.push_back(state);
+            }
+        }
+        std::sort(states.begin(), states.end());
+    }
+
+    // Returns the DFA state of a closed set of NFA states, adding it if it's new
+    int add_state(std::vector<int> states, bool at_start)
+    {
+        auto known = dfa_ids.find(states);
+        if (known != dfa_ids.end())
+            return known->second;
+
+        dfa_state state;
+        state.states = states;
+        state.accepting = std::binary_search(states.begin(), states.end(), 0);
+        closure(states, at_start, true);
+        state.accepting_at_end = std::binary_search(states.begin(), states.end(), 0);
+        state.dead = state.states.empty();
+        state.next.fill(-1);
+        dfa.push_back(std::move(state));
+        dfa_ids[dfa.back().states] = dfa.size() - 1;
+        return dfa.size() - 1;
+    }
+
+    // Returns the DFA state after a byte
+    int step(int state, unsigned char byte)
+    {
+        if (dfa[state].next[byte] >= 0)
+            return dfa[state].next[byte];
+
+        // Keep the cache bounded, only the current state is needed after clearing
+        if (dfa.size() >= max_dfa_states)
+        {
+            std::vector<int> states = dfa[state].states;
+            dfa.clear();
+            dfa_ids.clear();
+            dfa_start = -1;
+            state = add_state(states, false);
+        }
+
+        std::vector<int> next;
+        for (int nfa_state_index : dfa[state].states)
+            if (nfa[nfa_state_index].type == nfa_state::kind::bytes && nfa[nfa_state_index].set.test(byte))
+                next.push_back(nfa[nfa_state_index].out);
+        closure(next, false, false);
+        int next_state = add_state(next, false);
+        dfa[state].next[byte] = next_state;
+        return next_state;
+    }
+
+public:
+
+    regex_automaton(const regex_node& node)
+        : dfa_start(-1)
+    {
+
+        // State 0 accepts, a leading loop over any byte makes it match anywhere in the input
+        nfa.push_back({nfa_state::kind::accept, {}, -1, -1});
+        nfa_start = compile(node, 0);
+        if (!anchored(node))
+        {
+            nfa.push_back({nfa_state::kind::split, {}, nfa_start, -1});
+            nfa_start = nfa.size() - 1;
+            std::bitset<256> any;
+            any.set();
+            nfa.push_back({nfa_state::kind::bytes, any, nfa_start, -1});
+            nfa[nfa_start].out1 = nfa.size() - 1;
+        }
+    }
+
+    // Checks whether the expression matches any part of the input
+    bool match(std::string_view input)
+    {
+        if (dfa_start < 0)
+        {
+            std::vector<int> states{nfa_start};
+            closure(states, true, false);
+            dfa_start = add_state(states, true);
+        }
+
+        int state = dfa_start;
+        for (char byte : input)
+        {
+            if (dfa[state].accepting)
+                return true;
+            state = step(state, byte);
+            if (dfa[state].dead)
+                return false;
+        }
+        return dfa[state].accepting || dfa[state].accepting_at_end;
+    }
+};
+
+// Index of titles and synonyms of all live trees, roots are indexed lazily on first query after they are added
+class term_index
+{
+private:
+
+    // A distinct title or synonym, with all nodes having it
+    struct term
+    {
+        std::uint32_t id;
+        std::vector<const docview::doc_tree_node*> nodes;
+    };
+
+    // Terms by their string, a term might be in several trees, keys point to strings in nodes
+    std::unordered_map<std::string_view, term> terms;
+
+    // Strings of terms by id, a null view for removed terms, ids are never reused till compaction
+    std::vector<std::string_view> term_strings;
+
+    // Number of removed terms in term_strings
+    std::size_t removed_terms;
+
+    // Sorted ids of terms containing each trigram, a trigram is three bytes packed into an integer
+    std::unordered_map<std::uint32_t, std::vector<std::uint32_t>> trigrams;
+
+    // Strings of all terms in sorted order, for fuzzy searches, rebuilt when terms change
+    std::vector<std::string_view> sorted_terms;
+
+    // Whether sorted_terms is out of date, it might have views of freed strings then
+    bool sorted_terms_dirty;
+
+    // Pre-order and post-order numbers of a node, a node is in a subtree if it's interval is in root's interval
+    struct interval
+    {
+        std::uint64_t pre;
+        std::uint64_t post;
+    };
+
+    // Intervals of all indexed nodes, kept here as doc_tree_node can't get new members without breaking the ABI
+    std::unordered_map<const docview::doc_tree_node*, interval> intervals;
+
+    // Next number to give in intervals, trees are numbered one after another so intervals never overlap
+    std::uint64_t next_number;
+
+    // Roots added but not indexed yet
+    std::vector<const docview::doc_tree_node*> pending;
+
+    // Number of lookups till now
+    std::atomic<unsigned long> lookups;
+
+    // Mutex guarding all the above except lookups
+    std::shared_mutex mutex;
+
+    // Calls a function with every node of a tree and every term of the node, iteratively as trees might be deep
+    template <typename function_type>
+    static void for_each_term(const docview::doc_tree_node* root, function_type function)
+    {
+        std::vector<const docview::doc_tree_node*> stack{root};
+        while (!stack.empty())
+        {
+            const docview::doc_tree_node* node = stack.back();
+            stack.pop_back();
+            function(node, std::string_view(node->title));
+            for (auto& synonym : node->synonyms)
+                function(node, std::string_view(synonym));
+            stack.insert(stack.end(), node->children.begin(), node->children.end());
+        }
     }
-};
 
-// Loaded library (aka extension)
-static std::vector<dl_ptr> loaded_libs;
+    // Calls a function with every trigram of a string
+    template <typename function_type>
+    static void for_each_trigram(std::string_view string, function_type function)
+    {
+        for (std::size_t i = 0; i + 3 <= string.size(); i++)
+            function(
+                (std::uint32_t)(unsigned char)string[i] << 16 |
+                (std::uint32_t)(unsigned char)string[i + 1] << 8 |
+                (std::uint32_t)(unsigned char)string[i + 2]
+            );
+    }
 
-// Loaded extension objects
-static std::vector<docview::extension*> loaded_extensions;
+    // Adds a term with a new id to term_strings and trigrams
+    void add_term_trigrams(term& entry, std::string_view string)
+    {
+        entry.id = term_strings.size();
+        term_strings.push_back(string);
+        for_each_trigram(string, [&](std::uint32_t trigram) -> void
+        {
 
-// Loaded C extension objects
-static std::vector<std::shared_ptr<docview::extension>> loaded_c_extensions;
+            // Ids are increasing, so a repeated trigram of the term is at the back
+            auto& ids = trigrams[trigram];
+            if (ids.empty() || ids.back() != entry.id)
+                ids.push_back(entry.id);
+        });
+    }
 
-// All root nodes loaded till now, with the extension loaded it
-std::vector<std::pair<const docview::doc_tree_node*, docview::extension*>> root_nodes;
+    // Renumbers terms and rebuilds trigrams, to drop removed terms from them
+    void compact()
+    {
+        term_strings.clear();
+        trigrams.clear();
+        removed_terms = 0;
+        for (auto& entry : terms)
+            add_term_trigrams(entry.second, entry.first);
+    }
+
+    // Numbers a tree in pre-order and post-order, iteratively as trees might be deep
+    void number(const docview::doc_tree_node* root)
+    {
+
+        // Second of a pair is whether children of node are visited, the node gets post number then
+        std::vector<std::pair<const docview::doc_tree_node*, bool>> stack{{root, false}};
+        while (!stack.empty())
+        {
+            auto [node, visited] = stack.back();
+            stack.pop_back();
+            if (visited)
+            {
+                intervals[node].post = next_number++;
+                continue;
+            }
+            intervals[node].pre = next_number++;
+            stack.emplace_back(node, true);
+            for (auto child : node->children)
+                stack.emplace_back(child, false);
+        }
+    }
+
+    // Returns sorted terms starting with given prefix, they are adjacent
+    std::pair<std::vector<std::string_view>::iterator, std::vector<std::string_view>::iterator> prefix_range(
+        std::string_view prefix
+    )
+    {
+        auto begin = std::lower_bound(sorted_terms.begin(), sorted_terms.end(), prefix);
+        auto end = std::partition_point(begin, sorted_terms.end(),
+            [&](std::string_view term) -> bool { return term.substr(0, prefix.size()) == prefix; }
+        );
+        return std::make_pair(begin, end);
+    }
+
+    // Indexes pending roots, caller must hold mutex exclusively
+    void update()
+    {
+        DOCVIEW_SUBSYSTEM("term_index");
+        for (auto root : pending)
+            number(root);
+        for (auto root : pending)
+            for_each_term(root, [&](const docview::doc_tree_node* node, std::string_view string) -> void
+            {
+                auto [entry, inserted] = terms.try_emplace(string);
+                if (inserted)
+                {
+                    add_term_trigrams(entry->second, string);
+                    sorted_terms_dirty = true;
+                }
+
+                // A synonym might be same as title, list the node once
+                auto& nodes = entry->second.nodes;
+                if (nodes.empty() || nodes.back() != node)
+                    nodes.push_back(node);
+            });
+        pending.clear();
+    }
+
+    // Locks the index for reading, indexing pending roots first, and sorting terms if asked. Roots
+    // might be added between releasing the update lock and taking the read lock, so the check is
+    // repeated under the read lock till the index is up to date while it's held
+    std::shared_lock<std::shared_mutex> lock_updated(bool sorted = false)
+    {
+        while (true)
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex);
+            if (pending.empty() && !(sorted && sorted_terms_dirty))
+                return lock;
+            lock.unlock();
+
+            std::unique_lock<std::shared_mutex> update_lock(mutex);
+            update();
+            if (sorted && sorted_terms_dirty)
+            {
+                DOCVIEW_SUBSYSTEM("term_index");
+                sorted_terms.clear();
+                for (auto& entry : terms)
+                    sorted_terms.push_back(entry.first);
+                std::sort(sorted_terms.begin(), sorted_terms.end());
+                sorted_terms_dirty = false;
+            }
+        }
+    }
+
+    // Intersects sorted ids with a sorted posting list, galloping through the list as it's usually longer
+    static void intersect(std::vector<std::uint32_t>& ids, const std::vector<std::uint32_t>& list)
+    {
+        std::size_t kept = 0;
+        std::size_t position = 0;
+        for (auto id : ids)
+        {
+
+            // Double the step till it passes the id, then binary search the last step
+            std::size_t step = 1;
+            while (position + step < list.size() && list[position + step] < id)
+                step *= 2;
+            position = std::lower_bound(
+                list.begin() + position + step / 2, list.begin() + std::min(position + step + 1, list.size()), id
+            ) - list.begin();
+            if (position == list.size())
+                break;
+            if (list[position] == id)
+                ids[kept++] = id;
+        }
+        ids.resize(kept);
+    }
+
+public:
+
+    term_index()
+        : removed_terms(0),
+        sorted_terms_dirty(false),
+        next_number(0),
+        lookups(0)
+    {
+    }
+
+    // Adds a tree, it must not be freed before it's removed
+    void add(const docview::doc_tree_node* root)
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        pending.push_back(root);
+    }
+
+    // Removes a tree, after that it can be freed
+    void remove(const docview::doc_tree_node* root)
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        auto pending_root = std::find(pending.begin(), pending.end(), root);
+        if (pending_root != pending.end())
+        {
+            pending.erase(pending_root);
+            return;
+        }
+
+        DOCVIEW_SUBSYSTEM("term_index");
+        for_each_term(root, [&](const docview::doc_tree_node* node, std::string_view string) -> void
+        {
+            intervals.erase(node);
+            auto entry = terms.find(string);
+            if (entry == terms.end())
+                return;
+            auto& nodes = entry->second.nodes;
+            nodes.erase(std::remove(nodes.begin(), nodes.end(), node), nodes.end());
+            if (nodes.empty())
+            {
+                term_strings[entry->second.id] = std::string_view();
+                removed_terms++;
+                terms.erase(entry);
+                sorted_terms_dirty = true;
+            }
+
+            // The key might point to a string of this node, point it to the same string of another node
+            else if (entry->first.data() == string.data())
+            {
+                auto handle = terms.extract(entry);
+                const docview::doc_tree_node* other = handle.mapped().nodes.front();
+                handle.key() = other->title;
+                for (auto& synonym : other->synonyms)
+                    if (handle.key() != string)
+                        handle.key() = synonym;
+                term_strings[handle.mapped().id] = handle.key();
+                terms.insert(std::move(handle));
+                sorted_terms_dirty = true;
+            }
+        });
+
+        // Removed terms slow down substring searches, drop them once they are the majority
+        if (removed_terms > term_strings.size() / 2)
+            compact();
+    }
+
+    // Returns nodes with given title or synonym
+    std::vector<const docview::doc_tree_node*> lookup(std::string_view string)
+    {
+        lookups++;
+        auto lock = lock_updated();
+        auto entry = terms.find(string);
+        if (entry == terms.end())
+            return std::vector<const docview::doc_tree_node*>();
+        return entry->second.nodes;
+    }
+
+    // Returns nodes with a title or synonym containing given string
+    std::vector<const docview::doc_tree_node*> search_substring(std::string_view string)
+    {
+        auto lock = lock_updated();
+        DOCVIEW_SUBSYSTEM("term_index");
+
+        // Candidates are terms having all trigrams of the string, starting from the rarest trigram
+        std::vector<std::uint32_t> candidates;
+        if (string.size() < 3)
+        {
+            candidates.resize(term_strings.size());
+            for (std::uint32_t id = 0; id < candidates.size(); id++)
+                candidates[id] = id;
+        }
+        else
+        {
+            std::vector<const std::vector<std::uint32_t>*> lists;
+            bool missing = false;
+            for_each_trigram(string, [&](std::uint32_t trigram) -> void
+            {
+                auto ids = trigrams.find(trigram);
+                if (ids == trigrams.end())
+                    missing = true;
+                else
+                    lists.push_back(&ids->second);
+            });
+            if (missing)
+                return std::vector<const docview::doc_tree_node*>();
+            std::sort(lists.begin(), lists.end(), [](auto a, auto b) -> bool { return a->size() < b->size(); });
+            lists.erase(std::unique(lists.begin(), lists.end()), lists.end());
+            candidates = *lists.front();
+            for (std::size_t i = 1; i < lists.size() && !candidates.empty(); i++)
+                intersect(candidates, *lists[i]);
+        }
+
+        // Trigrams might be apart in the term, so check every candidate, a node might match by several terms
+        std::vector<const docview::doc_tree_node*> matches;
+        std::unordered_set<const docview::doc_tree_node*> matched;
+        for (auto id : candidates)
+        {
+            std::string_view candidate = term_strings[id];
+            if (!candidate.data() || candidate.find(string) == std::string_view::npos)
+                continue;
+            for (auto node : terms.find(candidate)->second.nodes)
+                if (matched.insert(node).second)
+                    matches.push_back(node);
+        }
+        return matches;
+    }
+
+    // Returns nodes with a title or synonym within given edit distance of given string, nearest first
+    std::vector<const docview::doc_tree_node*> search_fuzzy(std::string_view string, unsigned int max_distance)
+    {
+        auto lock = lock_updated(true);
+        DOCVIEW_SUBSYSTEM("term_index");
+
+        // Walk sorted terms like a trie, rows[d] is the row of edit distances after d bytes of the term, which
+        // is the state of a Levenshtein automaton, terms sharing a prefix share rows of that prefix
+        std::vector<std::vector<unsigned int>> rows(1, std::vector<unsigned int>(string.size() + 1));
+        for (std::size_t j = 0; j <= string.size(); j++)
+            rows[0][j] = j;
+        std::size_t valid_rows = 1;
+        std::string_view previous;
+
+        std::vector<std::pair<unsigned int, std::string_view>> found;
+        for (std::size_t i = 0; i < sorted_terms.size();)
+        {
+            std::string_view term = sorted_terms[i];
+
+            // Reuse rows of the prefix shared with previous term
+            std::size_t depth = 0;
+            while (depth < term.size() && depth < previous.size() && term[depth] == previous[depth])
+                depth++;
+            depth = std::min(depth, valid_rows - 1);
+            previous = term;
+
+            bool dead = false;
+            for (; depth < term.size(); depth++)
+            {
+                if (rows.size() <= depth + 1)
+                    rows.emplace_back(string.size() + 1);
+                const std::vector<unsigned int>& row = rows[depth];
+                std::vector<unsigned int>& next = rows[depth + 1];
+                next[0] = depth + 1;
+                unsigned int minimum = next[0];
+                for (std::size_t j = 1; j <= string.size(); j++)
+                {
+                    next[j] = std::min({row[j] + 1, next[j - 1] + 1, row[j - 1] + (term[depth] != string[j - 1])});
+                    minimum = std::min(minimum, next[j]);
+                }
+
+                // No term with this prefix can get within the distance, skip all of them
+                if (minimum > max_distance)
+                {
+                    std::string_view prefix = term.substr(0, depth + 1);
+                    i = std::partition_point(sorted_terms.begin() + i, sorted_terms.end(),
+                        [&](std::string_view other) -> bool { return other.substr(0, prefix.size()) == prefix; }
+                    ) - sorted_terms.begin();
+                    valid_rows = depth + 2;
+                    dead = true;
+                    break;
+                }
+            }
+            if (dead)
+                continue;
+
+            valid_rows = term.size() + 1;
+            if (rows[term.size()][string.size()] <= max_distance)
+                found.emplace_back(rows[term.size()][string.size()], term);
+            i++;
+        }
+
+        // Nearest terms first, a node might match by several terms
+        std::stable_sort(found.begin(), found.end(), [](auto& a, auto& b) -> bool { return a.first < b.first; });
+        std::vector<const docview::doc_tree_node*> matches;
+        std::unordered_set<const docview::doc_tree_node*> matched;
+        for (auto& term : found)
+            for (auto node : terms.find(term.second)->second.nodes)
+                if (matched.insert(node).second)
+                    matches.push_back(node);
+        return matches;
+    }
+
+    // Returns nodes with a title or synonym matching given regular expression
+    std::vector<const docview::doc_tree_node*> search_regex(const regex_node& expression)
+    {
+        std::vector<std::string> literals;
+        std::string prefix;
+        required_literals(expression, literals, &prefix);
+        literals.erase(
+            std::remove_if(literals.begin(), literals.end(), [](auto& literal) { return literal.size() < 3; }),
+            literals.end()
+        );
+
+        auto lock = lock_updated(literals.empty() && !prefix.empty());
+        DOCVIEW_SUBSYSTEM("term_index");
+
+        // Candidates are terms having all trigrams of required literals, or starting with the anchored prefix
+        std::vector<std::string_view> candidates;
+        if (!literals.empty())
+        {
+            std::vector<const std::vector<std::uint32_t>*> lists;
+            bool missing = false;
+            for (auto& literal : literals)
+                for_each_trigram(literal, [&](std::uint32_t trigram) -> void
+                {
+                    auto ids = trigrams.find(trigram);
+                    if (ids == trigrams.end())
+                        missing = true;
+                    else
+                        lists.push_back(&ids->second);
+                });
+            if (missing)
+                return std::vector<const docview::doc_tree_node*>();
+            std::sort(lists.begin(), lists.end(), [](auto a, auto b) -> bool { return a->size() < b->size(); });
+            lists.erase(std::unique(lists.begin(), lists.end()), lists.end());
+            std::vector<std::uint32_t> ids = *lists.front();
+            for (std::size_t i = 1; i < lists.size() && !ids.empty(); i++)
+                intersect(ids, *lists[i]);
+
+            // Trigrams might be apart, so check literals too, it's cheaper than running the automaton
+            for (auto id : ids)
+            {
+                std::string_view candidate = term_strings[id];
+                if (candidate.data() && std::all_of(literals.begin(), literals.end(),
+                    [&](auto& literal) { return candidate.find(literal) != std::string_view::npos; }))
+                    candidates.push_back(candidate);
+            }
+        }
+        else if (!prefix.empty())
+        {
+            auto begin = std::lower_bound(sorted_terms.begin(), sorted_terms.end(), std::string_view(prefix));
+            auto end = std::partition_point(begin, sorted_terms.end(),
+                [&](std::string_view term) -> bool { return term.substr(0, prefix.size()) == prefix; }
+            );
+            candidates.assign(begin, end);
+        }
+        else
+        {
+            for (auto term : term_strings)
+                if (term.data())
+                    candidates.push_back(term);
+        }
+
+        // Run the automaton only on candidates, a node might match by several terms
+        regex_automaton automaton(expression);
+        std::vector<const docview::doc_tree_node*> matches;
+        std::unordered_set<const docview::doc_tree_node*> matched;
+        for (auto candidate : candidates)
+        {
+            if (!automaton.match(candidate))
+                continue;
+            for (auto node : terms.find(candidate)->second.nodes)
+                if (matched.insert(node).second)
+                    matches.push_back(node);
+        }
+        return matches;
+    }
+
+    // Returns nodes with a title or synonym starting with the last segment, and ancestors named by the others
+    std::vector<const docview::doc_tree_node*> search_path(const std::vector<std::string>& segments)
+    {
+        auto lock = lock_updated(true);
+        DOCVIEW_SUBSYSTEM("term_index");
+
+        // Checks whether title or any synonym of a node is exactly given string
+        auto named = [](const docview::doc_tree_node* node, const std::string& name) -> bool
+        {
+            return node->title == name || std::find(node->synonyms.begin(), node->synonyms.end(), name) !=
+                node->synonyms.end();
+        };
+
+        // Candidates are nodes of terms starting with the last segment
+        auto [begin, end] = prefix_range(segments.back());
+        std::vector<const docview::doc_tree_node*> matches;
+        for (auto term = begin; term != end; term++)
+            for (auto node : terms.find(*term)->second.nodes)
+            {
+
+                // Match other segments with ancestors from nearest one, other ancestors might be between them
+                std::size_t segment = segments.size() - 1;
+                for (const docview::doc_tree_node* ancestor = node->parent; ancestor && segment; ancestor = ancestor->parent)
+                    if (named(ancestor, segments[segment - 1]))
+                        segment--;
+                if (segment == 0)
+                    matches.push_back(node);
+            }
+
+        // A node is a candidate once for it's title and once for every synonym starting with last segment
+        std::sort(matches.begin(), matches.end());
+        matches.erase(std::unique(matches.begin(), matches.end()), matches.end());
+        return matches;
+    }
+
+    // Returns nodes in subtree of given node with a title or synonym starting with given string
+    std::vector<const docview::doc_tree_node*> search_within(const docview::doc_tree_node* root, std::string_view string)
+    {
+        auto lock = lock_updated(true);
+        DOCVIEW_SUBSYSTEM("term_index");
+
+        auto scope = intervals.find(root);
+        if (scope == intervals.end())
+            throw std::invalid_argument("invalid node provided");
+
+        // Keep nodes whose intervals are in the interval of root
+        auto [begin, end] = prefix_range(string);
+        std::vector<const docview::doc_tree_node*> matches;
+        for (auto term = begin; term != end; term++)
+            for (auto node : terms.find(*term)->second.nodes)
+            {
+                const interval& position = intervals.find(node)->second;
+                if (scope->second.pre <= position.pre && position.post <= scope->second.post)
+                    matches.push_back(node);
+            }
+
+        // A node is a candidate once for it's title and once for every synonym starting with the string
+        std::sort(matches.begin(), matches.end());
+        matches.erase(std::unique(matches.begin(), matches.end()), matches.end());
+        return matches;
+    }
+
+    // Adds statistics of the index
+    void add_stats(docview::statistics& stats)
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        stats.index_terms = terms.size();
+        stats.index_trigrams = trigrams.size();
+        stats.index_pending_roots = pending.size();
+        stats.index_lookups = lookups.load(std::memory_order_relaxed);
+    }
+};
+
+// Index of all trees in root_nodes, updated along with it
+static term_index doc_index;
 
 // Converts a string to a dynamically allocated char array
 const char* c_str(const std::string& string)
 {
+    DOCVIEW_SUBSYSTEM("c_str");
     char* str = new char[string.size() + 1];
     std::memcpy(str, string.data(), string.size());
+    str[string.size()] = '\0';
     return str;
 }
 
-// Returns the owner extension of a node
+// Returns the owner extension of a node, caller must hold extensions_mutex
 docview::extension* get_extension(const docview::doc_tree_node* node)
 {
 
@@ -249,6 +2110,7 @@ docview::extension* get_extension(const docview::doc_tree_node* node)
         root = root->parent;
 
     // Find the corresponding extension
+    std::shared_lock<std::shared_mutex> lock(root_nodes_mutex);
     docview::extension* ext = nullptr;
     for (auto& root_node : root_nodes)
         if (root_node.first == root)
@@ -261,9 +2123,74 @@ docview::extension* get_extension(const docview::doc_tree_node* node)
     return ext;
 }
 
+// Returns the loaded library with given path, caller must hold extensions_mutex
+dl_ptr* find_lib(const std::filesystem::path& path)
+{
+    for (auto& lib : loaded_libs)
+        if (lib.path == path)
+            return &lib;
+    return nullptr;
+}
+
+// Locks the call mutex of an extension unless it's thread safe, caller must hold extensions_mutex
+std::unique_lock<std::mutex> lock_extension(docview::extension* ext)
+{
+    for (auto& lib : loaded_libs)
+        if (lib.extension == ext && !lib.thread_safe)
+            return std::unique_lock<std::mutex>(*lib.call_mutex);
+    return std::unique_lock<std::mutex>();
+}
+
+// All possible applicability level of an extension
+static std::array<docview::extension::applicability_level, 5> applicability_levels =
+{
+    docview::extension::applicability_level::tiny,
+    docview::extension::applicability_level::small,
+    docview::extension::applicability_level::medium,
+    docview::extension::applicability_level::big,
+    docview::extension::applicability_level::huge
+};
+
+// Parses a document with loaded extensions, caller must hold extensions_mutex
+const docview::doc_tree_node* parse_doc_tree(const std::filesystem::path& path)
+{
+    DOCVIEW_SUBSYSTEM("parse_doc_tree");
+
+    // Try to parse with extensions with applicability level from tiny to huge
+    for (auto& applicability : applicability_levels)
+    {
+        for (auto& extension : loaded_extensions)
+        {
+
+            // Make sure the extension matches applicability level
+            if (extension->get_applicability_level() != applicability) continue;
+
+            const docview::doc_tree_node* doc_tree;
+            {
+                auto extension_lock = lock_extension(extension);
+                DOCVIEW_EXTENSION_CALL("extension::get_doc_tree");
+                doc_tree = extension->get_doc_tree(path);
+            }
+            if (doc_tree)
+            {
+
+                // Add it to root nodes
+                std::unique_lock<std::shared_mutex> root_nodes_lock(root_nodes_mutex);
+                root_nodes.push_back(std::make_pair(doc_tree, extension));
+                doc_index.add(doc_tree);
+                return doc_tree;
+            }
+        }
+    }
+
+    // Parsing failed, return nullptr
+    return nullptr;
+}
+
 // Searchs through given node and child nodes of given node
 std::vector<const docview::doc_tree_node*> search_node(const docview::doc_tree_node* node, std::string query)
 {
+    DOCVIEW_SUBSYSTEM("search_node");
 
     // Matches found
     std::vector<const docview::doc_tree_node*> matches;
@@ -296,58 +2223,317 @@ std::vector<const docview::doc_tree_node*> search_node(const docview::doc_tree_n
     return matches;
 }
 
-// Returns the target of a symbolic link
-std::filesystem::path dereference(std::filesystem::path path)
+// Returns the target of a symbolic link, or an empty path if it's a link loop
+std::filesystem::path dereference(std::filesystem::path path)
+{
+    DOCVIEW_SUBSYSTEM("dereference");
+
+    // Resolve symlink address, one lstat per link, give up on link loops like the kernel does
+    std::error_code error;
+    for (int hops = 0; std::filesystem::is_symlink(std::filesystem::symlink_status(path, error)); hops++)
+    {
+
+        // An empty path doesn't exist, so callers treat the loop like a missing file instead of failing with ELOOP
+        if (hops == 40)
+            return std::filesystem::path();
+
+        // Get the target symbolic link
+        std::filesystem::path sym_path = std::filesystem::read_symlink(path, error);
+        if (error) break;
+
+        // Absolute targets replace the path, relative ones are appended to the parent directory
+        path = path.parent_path() / sym_path;
+    }
+
+    // Return path
+    return path;
+}
+
+// Magic and version of shared index segments, version is bumped whenever the layout changes
+static const char shared_index_control_magic[8] = "DVIXCTL";
+static const char shared_index_data_magic[8] = "DVIXDAT";
+static const std::uint32_t shared_index_version = 1;
+
+// Control segment of a shared index, named "/<name>", readers poll generation to find the data segment
+struct shared_index_control
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t reserved;
+
+    // Generation of the current data segment, 0 if nothing is published
+    std::atomic<std::uint64_t> generation;
+};
+
+// Header of a data segment, named "/<name>.<generation>", offsets are from the start of the segment
+struct shared_index_header
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t root_count;
+    std::uint32_t node_count;
+    std::uint32_t synonym_count;
+    std::uint32_t key_count;
+    std::uint32_t reserved;
+    std::uint64_t nodes_offset;
+    std::uint64_t synonyms_offset;
+    std::uint64_t keys_offset;
+    std::uint64_t strings_offset;
+    std::uint64_t size;
+};
+
+// A string in string table of a data segment
+struct shared_index_string
+{
+    std::uint32_t offset;
+    std::uint32_t length;
+};
+
+// A node, nodes are in breadth first order, so roots come first and children of a node are contiguous
+struct shared_index_node
+{
+    std::uint32_t parent;
+    std::uint32_t first_child;
+    std::uint32_t child_count;
+    std::uint32_t first_synonym;
+    std::uint32_t synonym_count;
+    shared_index_string title;
+};
+
+// A search key, a title or synonym of a node, keys are sorted by string
+struct shared_index_key
+{
+    shared_index_string string;
+    std::uint32_t node;
+};
+
+// A shared memory object, unmapped and closed when destroyed
+class shared_memory
+{
+public:
+
+    // File descriptor, -1 if not open
+    int fd;
+
+    // Mapped memory, nullptr if not mapped
+    void* data;
+
+    // Size of mapping
+    std::size_t size;
+
+    shared_memory(const std::string& name, int flags)
+        : fd(shm_open(name.c_str(), flags, 0644)),
+        data(nullptr),
+        size(0)
+    {
+    }
+
+    shared_memory(const shared_memory& other) = delete;
+    shared_memory& operator = (const shared_memory& other) = delete;
+
+    ~shared_memory()
+    {
+        if (data)
+            munmap(data, size);
+        if (fd >= 0)
+            close(fd);
+    }
+
+    // Maps the object, resizing it first if it's smaller, throws on failure
+    void map(std::size_t map_size, int protection)
+    {
+        struct stat status;
+        if (fstat(fd, &status) != 0 ||
+            ((std::size_t)status.st_size < map_size && ftruncate(fd, map_size) != 0))
+            throw std::runtime_error(std::string("failed to resize shared memory: ") + std::strerror(errno));
+        void* mapping = mmap(nullptr, map_size, protection, MAP_SHARED, fd, 0);
+        if (mapping == MAP_FAILED)
+            throw std::runtime_error(std::string("failed to map shared memory: ") + std::strerror(errno));
+        data = mapping;
+        size = map_size;
+    }
+};
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "shared index needs lock free 64 bit atomics");
+
+// Generation and size of the last index published by this process
+static std::atomic<unsigned long> published_index_generation(0);
+static std::atomic<unsigned long> published_index_bytes(0);
+
+// Returns the name of shared memory object of a shared index, of it's control segment if generation is 0
+std::string shared_index_object_name(const std::string& name, std::uint64_t generation)
+{
+    if (name.empty() || name.size() > 200 || name.find('/') != std::string::npos)
+        throw std::invalid_argument("invalid shared index name provided");
+    return "/" + name + (generation ? "." + std::to_string(generation) : std::string());
+}
+
+// Returns the string with given reference in a data segment
+std::string_view shared_index_string_view(const void* data, const shared_index_string& string)
+{
+    const shared_index_header* header = (const shared_index_header*)data;
+    return std::string_view((const char*)data + header->strings_offset + string.offset, string.length);
+}
+
+// Returns a node of a mapped data segment, throws if there is no such node
+const shared_index_node& shared_index_get_node(const void* data, unsigned long node)
+{
+    const shared_index_header* header = (const shared_index_header*)data;
+    if (node >= header->node_count)
+        throw std::invalid_argument("invalid node provided");
+    return ((const shared_index_node*)((const char*)data + header->nodes_offset))[node];
+}
+
+// Flattens all live trees into a data segment image, caller must hold extensions_mutex and root_nodes_mutex
+std::vector<char> build_shared_index()
 {
+    DOCVIEW_SUBSYSTEM("build_shared_index");
 
-    // Resolve symlink address
-    while (std::filesystem::exists(path) && std::filesystem::is_symlink(path))
-    {
+    std::vector<shared_index_node> nodes;
+    std::vector<shared_index_string> synonyms;
+    std::vector<shared_index_key> keys;
+    std::string strings;
 
-        // Get the target symbolic link
-        std::filesystem::path sym_path = std::filesystem::read_symlink(path);
+    // Appends a string to the string table
+    auto add_string = [&](const std::string& string) -> shared_index_string
+    {
+        shared_index_string reference = {(std::uint32_t)strings.size(), (std::uint32_t)string.size()};
+        strings += string;
+        return reference;
+    };
 
-        // If target is absolute, assign it to path
-        if (std::string(path)[0] != '/')
+    // Number the nodes breadth first, children are numbered when their parent is visited
+    std::vector<const docview::doc_tree_node*> queue;
+    for (auto& root_node : root_nodes)
+    {
+        queue.push_back(root_node.first);
+        nodes.push_back({UINT32_MAX, 0, 0, 0, 0, {}});
+    }
+    for (std::size_t i = 0; i < queue.size(); i++)
+    {
+        const docview::doc_tree_node* node = queue[i];
+        nodes[i].title = add_string(node->title);
+        keys.push_back({nodes[i].title, (std::uint32_t)i});
+        nodes[i].first_synonym = synonyms.size();
+        nodes[i].synonym_count = node->synonyms.size();
+        for (auto& synonym : node->synonyms)
         {
-            path = sym_path;
+            synonyms.push_back(add_string(synonym));
+            keys.push_back({synonyms.back(), (std::uint32_t)i});
         }
-
-        // Otherwise, append it to path's parent with a directory
-        else
+        nodes[i].first_child = queue.size();
+        nodes[i].child_count = node->children.size();
+        for (auto child : node->children)
         {
-            path = path.parent_path() / sym_path;
+            queue.push_back(child);
+            nodes.push_back({(std::uint32_t)i, 0, 0, 0, 0, {}});
         }
     }
+    if (strings.size() > UINT32_MAX || nodes.size() > UINT32_MAX - 1)
+        throw std::runtime_error("document trees are too big for shared index");
 
-    // Return path
-    return path;
+    // Sort keys, so that all keys starting with a query are adjacent
+    std::sort(keys.begin(), keys.end(), [&](const shared_index_key& a, const shared_index_key& b) -> bool
+    {
+        return std::string_view(strings.data() + a.string.offset, a.string.length) <
+            std::string_view(strings.data() + b.string.offset, b.string.length);
+    });
+
+    // Lay out the tables one after another, each aligned to 8 bytes
+    auto align = [](std::uint64_t offset) -> std::uint64_t { return (offset + 7) & ~(std::uint64_t)7; };
+    shared_index_header header = {};
+    std::memcpy(header.magic, shared_index_data_magic, sizeof(header.magic));
+    header.version = shared_index_version;
+    header.root_count = root_nodes.size();
+    header.node_count = nodes.size();
+    header.synonym_count = synonyms.size();
+    header.key_count = keys.size();
+    header.nodes_offset = align(sizeof(header));
+    header.synonyms_offset = align(header.nodes_offset + nodes.size() * sizeof(shared_index_node));
+    header.keys_offset = align(header.synonyms_offset + synonyms.size() * sizeof(shared_index_string));
+    header.strings_offset = align(header.keys_offset + keys.size() * sizeof(shared_index_key));
+    header.size = header.strings_offset + strings.size();
+
+    std::vector<char> image(header.size);
+    std::memcpy(image.data(), &header, sizeof(header));
+    std::memcpy(image.data() + header.nodes_offset, nodes.data(), nodes.size() * sizeof(shared_index_node));
+    std::memcpy(image.data() + header.synonyms_offset, synonyms.data(), synonyms.size() * sizeof(shared_index_string));
+    std::memcpy(image.data() + header.keys_offset, keys.data(), keys.size() * sizeof(shared_index_key));
+    std::memcpy(image.data() + header.strings_offset, strings.data(), strings.size());
+    return image;
 }
 
-// All possible applicability level of an extension
-static std::array<docview::extension::applicability_level, 5> applicability_levels =
+// Checks whether a mapped data segment is complete and consistent with it's header, and that
+// every node, synonym, child and string it refers to is inside it, so readers needn't check
+// again. A published segment is never written again, so checking once after mapping is enough
+bool validate_shared_index(const void* data, std::size_t size)
 {
-    docview::extension::applicability_level::tiny,
-    docview::extension::applicability_level::small,
-    docview::extension::applicability_level::medium,
-    docview::extension::applicability_level::big,
-    docview::extension::applicability_level::huge
-};
+    const shared_index_header* header = (const shared_index_header*)data;
+    auto aligned = [](std::uint64_t offset) -> bool { return offset % 8 == 0; };
+    if (size < sizeof(shared_index_header) ||
+        std::memcmp(header->magic, shared_index_data_magic, sizeof(header->magic)) != 0 ||
+        header->version != shared_index_version ||
+        header->size != size ||
+        header->root_count > header->node_count ||
+        !aligned(header->nodes_offset) || !aligned(header->synonyms_offset) || !aligned(header->keys_offset) ||
+        header->nodes_offset < sizeof(shared_index_header) ||
+        header->nodes_offset > size || header->synonyms_offset > size ||
+        header->keys_offset > size || header->strings_offset > size ||
+        header->nodes_offset + (std::uint64_t)header->node_count * sizeof(shared_index_node) > header->synonyms_offset ||
+        header->synonyms_offset + (std::uint64_t)header->synonym_count * sizeof(shared_index_string) > header->keys_offset ||
+        header->keys_offset + (std::uint64_t)header->key_count * sizeof(shared_index_key) > header->strings_offset)
+        return false;
+
+    // Every string must be inside the string table
+    std::uint64_t strings_size = size - header->strings_offset;
+    auto valid_string = [&](const shared_index_string& string) -> bool
+    {
+        return (std::uint64_t)string.offset + string.length <= strings_size;
+    };
+
+    const shared_index_node* nodes = (const shared_index_node*)((const char*)data + header->nodes_offset);
+    for (std::uint32_t i = 0; i < header->node_count; i++)
+    {
+        const shared_index_node& node = nodes[i];
+        if (!valid_string(node.title) ||
+            (i < header->root_count ? node.parent != UINT32_MAX : node.parent >= header->node_count) ||
+            (std::uint64_t)node.first_child + node.child_count > header->node_count ||
+            (std::uint64_t)node.first_synonym + node.synonym_count > header->synonym_count)
+            return false;
+    }
+
+    const shared_index_string* synonyms = (const shared_index_string*)((const char*)data + header->synonyms_offset);
+    for (std::uint32_t i = 0; i < header->synonym_count; i++)
+        if (!valid_string(synonyms[i]))
+            return false;
+
+    const shared_index_key* keys = (const shared_index_key*)((const char*)data + header->keys_offset);
+    for (std::uint32_t i = 0; i < header->key_count; i++)
+        if (!valid_string(keys[i].string) || keys[i].node >= header->node_count)
+            return false;
+
+    return true;
+}
 
 namespace docview
 {
     void load_ext(std::filesystem::path path)
     {
+        DOCVIEW_API_CALL("docview::load_ext");
 
-        // Dereference path if required
+        // Dereference path if required, the link is named in errors as a link loop gives an empty path
+        std::filesystem::path link = path;
         path = dereference(path);
 
+        // Loading modifies the extension list, so wait for all callers to finish
+        std::unique_lock<std::shared_mutex> lock(extensions_mutex);
+
         // If extension is already loaded, do nothing
-        if(is_loaded(path)) return;
+        if (find_lib(path)) return;
 
         // If path is non-existant, throw exception
         if (!std::filesystem::exists(path))
-            throw std::runtime_error(std::string(path) + " doesn't exist");
+            throw std::runtime_error(std::string(link) + " doesn't exist");
 
         // Load the extension file into memory
         loaded_libs.emplace_back(path);
@@ -399,6 +2585,12 @@ namespace docview
             extension = c_ext.get();
         }
 
+        // Extensions may declare that they can be called from several threads at once
+        const bool* thread_safe = (const bool*)dlsym(
+            loaded_libs[loaded_libs.size() - 1].handle, "extension_thread_safe"
+        );
+        loaded_libs[loaded_libs.size() - 1].thread_safe = thread_safe && *thread_safe;
+
         // Add extension object to loaded extension
         loaded_extensions.push_back(extension);
 
@@ -408,33 +2600,42 @@ namespace docview
 
     void unload_ext(std::filesystem::path path)
     {
+        DOCVIEW_API_CALL("docview::unload_ext");
 
         // Dereference path if required
         path = dereference(path);
 
+        // Unloading invalidates the extension, so wait for all callers to finish
+        std::unique_lock<std::shared_mutex> lock(extensions_mutex);
+
         // Find out the extension to unload
-        dl_ptr* lib_to_unload = nullptr;
-        for (auto& lib : loaded_libs)
-            if (lib.path == path)
-            {
-                lib_to_unload = &lib;
-                break;
-            }
+        dl_ptr* lib_to_unload = find_lib(path);
 
         // If not found, simply return
         if (lib_to_unload == nullptr)
             return;
 
         // Remove all root_nodes associated the extension
-        for (unsigned long i = 0; i < root_nodes.size(); i++)
-            if (root_nodes[i].second == lib_to_unload->extension)
-                root_nodes.erase(root_nodes.begin() + i--);
+        {
+            std::unique_lock<std::shared_mutex> root_nodes_lock(root_nodes_mutex);
+            for (unsigned long i = 0; i < root_nodes.size(); i++)
+                if (root_nodes[i].second == lib_to_unload->extension)
+                {
+                    doc_index.remove(root_nodes[i].first);
+                    root_nodes.erase(root_nodes.begin() + i--);
+                }
+        }
 
         // Remove the extension
         for (unsigned int i = 0; i < loaded_extensions.size(); i++)
             if (loaded_extensions[i] == lib_to_unload->extension)
                 loaded_extensions.erase(loaded_extensions.begin() + i--);
 
+        // Destroy the wrapper if it's written in C, freeing the nodes copied from it
+        for (unsigned int i = 0; i < loaded_c_extensions.size(); i++)
+            if (loaded_c_extensions[i].get() == lib_to_unload->extension)
+                loaded_c_extensions.erase(loaded_c_extensions.begin() + i--);
+
         // Remove the extension file
         for (unsigned int i = 0; i < loaded_libs.size(); i++)
             if (&loaded_libs[i] == lib_to_unload)
@@ -446,76 +2647,238 @@ namespace docview
 
     const doc_tree_node* get_doc_tree(std::filesystem::path path)
     {
+        DOCVIEW_API_CALL("docview::get_doc_tree");
 
-        // Dereference path if required
+        // Dereference path if required, the link is named in errors as a link loop gives an empty path
+        std::filesystem::path link = path;
+        path = dereference(path);
+
+        // If path is non-existant, throw exception
+        if (!std::filesystem::exists(path))
+            throw std::runtime_error(std::string(link) + " doesn't exist");
+
+        // Keep extensions loaded while parsing
+        std::shared_lock<std::shared_mutex> lock(extensions_mutex);
+        return parse_doc_tree(path);
+    }
+
+    const doc_tree_node* get_doc_tree(std::filesystem::path path, std::filesystem::path extension_path)
+    {
+        DOCVIEW_API_CALL("docview::get_doc_tree");
+
+        // Dereference paths if required, the link is named in errors as a link loop gives an empty path
+        std::filesystem::path link = path;
         path = dereference(path);
+        extension_path = dereference(extension_path);
 
         // If path is non-existant, throw exception
         if (!std::filesystem::exists(path))
-            throw std::runtime_error(std::string(path) + " doesn't exist");
+            throw std::runtime_error(std::string(link) + " doesn't exist");
+
+        // Keep extensions loaded while parsing
+        std::shared_lock<std::shared_mutex> lock(extensions_mutex);
+
+        // Find the extension, throw if it isn't loaded
+        dl_ptr* lib = find_lib(extension_path);
+        if (!lib)
+            throw std::invalid_argument(std::string(extension_path) + " isn't loaded");
+
+        // Parse with only that extension
+        const doc_tree_node* doc_tree;
+        {
+            auto extension_lock = lock_extension(lib->extension);
+            DOCVIEW_EXTENSION_CALL("extension::get_doc_tree");
+            doc_tree = lib->extension->get_doc_tree(path);
+        }
+        if (doc_tree)
+        {
+
+            // Add it to root nodes
+            std::unique_lock<std::shared_mutex> root_nodes_lock(root_nodes_mutex);
+            root_nodes.push_back(std::make_pair(doc_tree, lib->extension));
+            doc_index.add(doc_tree);
+        }
+        return doc_tree;
+    }
 
-        // Try to parse with extensions with applicability level from tiny to huge
-        for (auto& applicability : applicability_levels)
+    std::vector<const doc_tree_node*> get_doc_trees(std::vector<std::filesystem::path> paths)
+    {
+        DOCVIEW_API_CALL("docview::get_doc_trees");
+        std::vector<const doc_tree_node*> trees(paths.size(), nullptr);
+
+        // Keep extensions loaded while parsing, workers rely on this lock
+        std::shared_lock<std::shared_mutex> lock(extensions_mutex);
+
+        // Parse every path in the pool, each task writes only to it's own slot
+        work_stealing_pool& pool = work_stealing_pool::shared();
+        work_stealing_pool::task_group group;
+        for (unsigned long i = 0; i < paths.size(); i++)
         {
-            for (auto& extension : loaded_extensions)
+            pool.submit(group, [&, i]() -> void
             {
 
-                // Make sure the extension matches applicability level
-                if (extension->get_applicability_level() != applicability) continue;
+                // Unreadable paths and link loops aren't documents, leave their slots nullptr
+                std::error_code error;
+                std::filesystem::path path = dereference(paths[i]);
+                if (std::filesystem::exists(path, error))
+                    trees[i] = parse_doc_tree(path);
+            });
+        }
+        pool.wait(group);
+
+        return trees;
+    }
 
-                const doc_tree_node* doc_tree = extension->get_doc_tree(path);
-                if (doc_tree)
-                {
+    std::vector<std::filesystem::path> find_documents(std::filesystem::path directory, unsigned int max_depth)
+    {
+        DOCVIEW_API_CALL("docview::find_documents");
+        return directory_walker(work_stealing_pool::shared(), max_depth).run(directory);
+    }
 
-                    // Add it to root nodes
-                    root_nodes.push_back(std::make_pair(doc_tree, extension));
-                    return doc_tree;
-                }
+    void release_doc_tree(const doc_tree_node* root)
+    {
+        DOCVIEW_API_CALL("docview::release_doc_tree");
+
+        // Forget the root, the memory is still managed by the extension, but wrappers of extensions
+        // written in C own copies of their trees, which are freed
+        std::shared_lock<std::shared_mutex> lock(extensions_mutex);
+        std::unique_lock<std::shared_mutex> root_nodes_lock(root_nodes_mutex);
+        for (unsigned long i = 0; i < root_nodes.size(); i++)
+            if (root_nodes[i].first == root)
+            {
+                doc_index.remove(root);
+                docview::extension* extension = root_nodes[i].second;
+                root_nodes.erase(root_nodes.begin() + i);
+                for (auto& c_ext : loaded_c_extensions)
+                    if (c_ext.get() == extension)
+                        std::static_pointer_cast<c_extension>(c_ext)->release_doc_tree(root);
+                break;
             }
+    }
+
+    std::filesystem::path get_owner(const doc_tree_node* node)
+    {
+        DOCVIEW_API_CALL("docview::get_owner");
+        std::shared_lock<std::shared_mutex> lock(extensions_mutex);
+        docview::extension* extension = get_extension(node);
+
+        // Find the file the extension was loaded from
+        for (auto& lib : loaded_libs)
+            if (lib.extension == extension)
+                return lib.path;
+
+        throw std::invalid_argument("invalid node provided");
+    }
+
+    std::vector<std::filesystem::path> get_owners(std::vector<const doc_tree_node*> nodes)
+    {
+        DOCVIEW_API_CALL("docview::get_owners");
+        std::shared_lock<std::shared_mutex> lock(extensions_mutex);
+        std::shared_lock<std::shared_mutex> root_nodes_lock(root_nodes_mutex);
+
+        // Map roots to extensions and extensions to files once, instead of scanning them for every node
+        std::unordered_map<const doc_tree_node*, docview::extension*> extensions;
+        for (auto& root_node : root_nodes)
+            extensions[root_node.first] = root_node.second;
+        std::unordered_map<docview::extension*, std::filesystem::path> paths;
+        for (auto& lib : loaded_libs)
+            paths[lib.extension] = lib.path;
+
+        std::vector<std::filesystem::path> owners;
+        owners.reserve(nodes.size());
+        for (auto node : nodes)
+        {
+            const doc_tree_node* root = node;
+            while (root->parent)
+                root = root->parent;
+            auto extension = extensions.find(root);
+            if (extension == extensions.end())
+                throw std::invalid_argument("invalid node provided");
+            auto path = paths.find(extension->second);
+            if (path == paths.end())
+                throw std::invalid_argument("invalid node provided");
+            owners.push_back(path->second);
         }
+        return owners;
+    }
 
-        // Parsing failed, return nullptr
-        return nullptr;
+    extension::applicability_level get_applicability_level(std::filesystem::path path)
+    {
+        DOCVIEW_API_CALL("docview::get_applicability_level");
+
+        // Dereference path if required
+        path = dereference(path);
+
+        // Find the extension, throw if it isn't loaded
+        std::shared_lock<std::shared_mutex> lock(extensions_mutex);
+        dl_ptr* lib = find_lib(path);
+        if (!lib)
+            throw std::invalid_argument(std::string(path) + " isn't loaded");
+
+        return lib->extension->get_applicability_level();
     }
 
     bool is_loaded(std::filesystem::path path)
     {
+        DOCVIEW_API_CALL("docview::is_loaded");
 
         // Dereference path if required
         path = dereference(path);
 
         // Search for path in loaded library, return true or match, false otherwise
-        for (unsigned long i = 0; i < loaded_libs.size(); i++)
-        {
-            if (loaded_libs[i].path == path) return true;
-        }
-        return false;
+        std::shared_lock<std::shared_mutex> lock(extensions_mutex);
+        return find_lib(path) != nullptr;
     }
 
     std::pair<std::string, bool> get_doc(const doc_tree_node* node)
     {
-        return get_extension(node)->get_doc(node);
+        DOCVIEW_API_CALL("docview::get_doc");
+        std::shared_lock<std::shared_mutex> lock(extensions_mutex);
+        docview::extension* extension = get_extension(node);
+        auto extension_lock = lock_extension(extension);
+        DOCVIEW_EXTENSION_CALL("extension::get_doc");
+        return extension->get_doc(node);
     }
 
     std::string brief(const doc_tree_node* node)
     {
-        return get_extension(node)->brief(node);
+        DOCVIEW_API_CALL("docview::brief");
+        std::shared_lock<std::shared_mutex> lock(extensions_mutex);
+        docview::extension* extension = get_extension(node);
+        auto extension_lock = lock_extension(extension);
+        DOCVIEW_EXTENSION_CALL("extension::brief");
+        return extension->brief(node);
     }
 
     std::string details(const doc_tree_node* node)
     {
-        return get_extension(node)->details(node);
+        DOCVIEW_API_CALL("docview::details");
+        std::shared_lock<std::shared_mutex> lock(extensions_mutex);
+        docview::extension* extension = get_extension(node);
+        auto extension_lock = lock_extension(extension);
+        DOCVIEW_EXTENSION_CALL("extension::details");
+        return extension->details(node);
     }
     
     std::string section(const doc_tree_node* node, std::string section)
     {
-        return get_extension(node)->section(node, section);
+        DOCVIEW_API_CALL("docview::section");
+        std::shared_lock<std::shared_mutex> lock(extensions_mutex);
+        docview::extension* extension = get_extension(node);
+        auto extension_lock = lock_extension(extension);
+        DOCVIEW_EXTENSION_CALL("extension::section");
+        return extension->section(node, section);
     }
 
     std::vector<const doc_tree_node*> search(std::string query)
     {
+        DOCVIEW_API_CALL("docview::search");
         std::vector<const doc_tree_node*> matches;
 
+        // Keep trees alive while searching
+        std::shared_lock<std::shared_mutex> lock(extensions_mutex);
+        std::shared_lock<std::shared_mutex> root_nodes_lock(root_nodes_mutex);
+
         // Search through all root nodes and their children
         for (auto& root_node : root_nodes)
         {
@@ -531,8 +2894,12 @@ namespace docview
         std::vector<std::pair<const docview::doc_tree_node*, std::filesystem::path>> document_roots
     )
     {
+        DOCVIEW_API_CALL("docview::search");
         std::vector<const doc_tree_node*> matches;
 
+        // Keep trees alive while searching
+        std::shared_lock<std::shared_mutex> lock(extensions_mutex);
+
         // Search through all root nodes and their children
         for (auto& root_node : document_roots)
         {
@@ -543,8 +2910,69 @@ namespace docview
         return matches;
     }
 
+    std::vector<const doc_tree_node*> lookup(std::string name)
+    {
+        DOCVIEW_API_CALL("docview::lookup");
+        return doc_index.lookup(name);
+    }
+
+    std::vector<const doc_tree_node*> search_substring(std::string query)
+    {
+        DOCVIEW_API_CALL("docview::search_substring");
+        return doc_index.search_substring(query);
+    }
+
+    std::vector<const doc_tree_node*> search_fuzzy(std::string query, unsigned int max_distance)
+    {
+        DOCVIEW_API_CALL("docview::search_fuzzy");
+        return doc_index.search_fuzzy(query, max_distance);
+    }
+
+    std::vector<const doc_tree_node*> search_regex(std::string pattern)
+    {
+        DOCVIEW_API_CALL("docview::search_regex");
+
+        // Parse before locking the index, parsing throws on invalid patterns
+        regex_node expression = regex_parser(pattern).parse();
+        return doc_index.search_regex(expression);
+    }
+
+    std::vector<const doc_tree_node*> search_path(std::string query)
+    {
+        DOCVIEW_API_CALL("docview::search_path");
+
+        // Split the query at "::", or at ">" if there is no "::"
+        std::string separator = query.find("::") != std::string::npos ? "::" : ">";
+        std::vector<std::string> segments;
+        std::size_t begin = 0;
+        while (true)
+        {
+            std::size_t end = query.find(separator, begin);
+            std::string segment = query.substr(begin, end == std::string::npos ? std::string::npos : end - begin);
+
+            // Strip spaces around segments, "a > b" is same as "a>b"
+            std::size_t first = segment.find_first_not_of(' ');
+            segment = first == std::string::npos ? "" : segment.substr(first, segment.find_last_not_of(' ') - first + 1);
+            if (!segment.empty() || end == std::string::npos)
+                segments.push_back(segment);
+
+            if (end == std::string::npos)
+                break;
+            begin = end + separator.size();
+        }
+
+        return doc_index.search_path(segments);
+    }
+
+    std::vector<const doc_tree_node*> search_within(const doc_tree_node* node, std::string query)
+    {
+        DOCVIEW_API_CALL("docview::search_within");
+        return doc_index.search_within(node, query);
+    }
+
     bool validate(const doc_tree_node* node)
     {
+        DOCVIEW_API_CALL("docview::validate");
 
         // Get the root node
         const doc_tree_node* root = node;
@@ -552,17 +2980,374 @@ namespace docview
             root = root->parent;
 
         // Compare with every valid root node, return true on match
+        std::shared_lock<std::shared_mutex> lock(root_nodes_mutex);
         for (auto& root_node : root_nodes)
             if (root == root_node.first)
                 return true;
 
-        // None matched, the node is valid
-        return false;
+        // None matched, the node is valid
+        return false;
+    }
+
+    std::string export_trace()
+    {
+        std::stringstream trace;
+        trace << "{\"traceEvents\":[";
+
+#ifdef DOCVIEW_TRACING
+        bool first = true;
+        std::lock_guard<std::mutex> lock(trace_buffers_mutex);
+        for (auto& buffer : trace_buffers)
+        {
+
+            // Owner thread might be recording meanwhile, skip events overwritten while reading them
+            unsigned long count = buffer->count.load(std::memory_order_acquire);
+            unsigned long oldest = count > trace_buffer::capacity ? count - trace_buffer::capacity : 0;
+            for (unsigned long i = oldest; i < count; i++)
+            {
+                const char* name;
+                std::uint64_t begin, duration;
+                if (!buffer->read(i, name, begin, duration))
+                    continue;
+                trace << (first ? "" : ",") << "{\"name\":\"" << name << "\",\"ph\":\"X\""
+                    << ",\"ts\":" << begin / 1000 << "." << begin % 1000 / 100
+                    << ",\"dur\":" << duration / 1000 << "." << duration % 1000 / 100
+                    << ",\"pid\":" << getpid() << ",\"tid\":" << buffer->thread_id << "}";
+                first = false;
+            }
+        }
+#endif
+
+        trace << "]}";
+        return trace.str();
+    }
+
+    statistics stats()
+    {
+        DOCVIEW_API_CALL("docview::stats");
+        statistics stats = {};
+
+        // Keep extensions and trees alive while counting
+        std::shared_lock<std::shared_mutex> lock(extensions_mutex);
+        std::shared_lock<std::shared_mutex> root_nodes_lock(root_nodes_mutex);
+
+        stats.loaded_extensions = loaded_libs.size();
+        for (auto& lib : loaded_libs)
+            if (lib.thread_safe)
+                stats.thread_safe_extensions++;
+        stats.c_extensions = loaded_c_extensions.size();
+        for (auto& extension : loaded_c_extensions)
+            std::static_pointer_cast<c_extension>(extension)->add_stats(stats);
+
+        // Count nodes of all trees, iteratively as trees might be deep
+        stats.roots = root_nodes.size();
+        std::vector<const doc_tree_node*> stack;
+        for (auto& root_node : root_nodes)
+        {
+            stack.push_back(root_node.first);
+            while (!stack.empty())
+            {
+                const doc_tree_node* node = stack.back();
+                stack.pop_back();
+                stats.nodes++;
+                stack.insert(stack.end(), node->children.begin(), node->children.end());
+            }
+        }
+
+        work_stealing_pool& pool = work_stealing_pool::shared();
+        stats.pool_threads = pool.thread_count();
+        stats.pool_queued_tasks = pool.queued_tasks();
+        stats.pool_tasks_run = pool.tasks_run();
+        stats.pool_tasks_stolen = pool.tasks_stolen();
+
+        doc_index.add_stats(stats);
+
+        stats.shared_index_generation = published_index_generation;
+        stats.shared_index_bytes = published_index_bytes;
+
+        return stats;
+    }
+
+    std::vector<allocation_count> get_allocation_counts()
+    {
+        std::vector<allocation_count> counts;
+
+#ifdef DOCVIEW_ALLOCATION_ACCOUNTING
+        // Several counters might have same name, like overloads of a function, merge them
+        std::lock_guard<std::mutex> lock(allocation_counters_mutex());
+        for (auto counter : allocation_counters())
+        {
+            auto count = std::find_if(counts.begin(), counts.end(), [&](const allocation_count& count) -> bool
+            {
+                return count.name == counter->name && count.api == counter->api;
+            });
+            if (count == counts.end())
+                count = counts.insert(counts.end(), {counter->name, counter->api, 0, 0});
+            count->allocations += counter->allocations.load(std::memory_order_relaxed);
+            count->bytes += counter->bytes.load(std::memory_order_relaxed);
+        }
+#endif
+
+        return counts;
+    }
+
+    void reset_allocation_counts()
+    {
+#ifdef DOCVIEW_ALLOCATION_ACCOUNTING
+        std::lock_guard<std::mutex> lock(allocation_counters_mutex());
+        for (auto counter : allocation_counters())
+        {
+            counter->allocations = 0;
+            counter->bytes = 0;
+        }
+#endif
+    }
+
+    unsigned long publish_shared_index(std::string name)
+    {
+        DOCVIEW_API_CALL("docview::publish_shared_index");
+
+        // Open or create the control segment, holding it's lock makes this process the only writer
+        shared_memory control(shared_index_object_name(name, 0), O_RDWR | O_CREAT);
+        if (control.fd < 0 || flock(control.fd, LOCK_EX) != 0)
+            throw std::runtime_error("failed to open shared index " + name + ": " + std::strerror(errno));
+        control.map(sizeof(shared_index_control), PROT_READ | PROT_WRITE);
+        shared_index_control* header = (shared_index_control*)control.data;
+        if (std::memcmp(header->magic, shared_index_control_magic, sizeof(header->magic)) != 0 ||
+            header->version != shared_index_version)
+        {
+            std::memcpy(header->magic, shared_index_control_magic, sizeof(header->magic));
+            header->version = shared_index_version;
+        }
+
+        // Flatten the trees, they need to be alive only meanwhile
+        std::vector<char> image;
+        {
+            std::shared_lock<std::shared_mutex> lock(extensions_mutex);
+            std::shared_lock<std::shared_mutex> root_nodes_lock(root_nodes_mutex);
+            image = build_shared_index();
+        }
+
+        // Write the next generation, a leftover of a crashed writer might have the same name
+        std::uint64_t generation = header->generation.load(std::memory_order_relaxed) + 1;
+        std::string data_name = shared_index_object_name(name, generation);
+        shm_unlink(data_name.c_str());
+        {
+            shared_memory data(data_name, O_RDWR | O_CREAT | O_EXCL);
+            if (data.fd < 0)
+                throw std::runtime_error("failed to create shared index " + name + ": " + std::strerror(errno));
+            try
+            {
+                data.map(image.size(), PROT_READ | PROT_WRITE);
+            }
+            catch (std::runtime_error&)
+            {
+                shm_unlink(data_name.c_str());
+                throw;
+            }
+            std::memcpy(data.data, image.data(), image.size());
+        }
+
+        // Swap generations, readers which mapped the old one keep using it till they refresh
+        header->generation.store(generation, std::memory_order_release);
+        if (generation > 1)
+            shm_unlink(shared_index_object_name(name, generation - 1).c_str());
+
+        published_index_generation = generation;
+        published_index_bytes = image.size();
+        return generation;
+    }
+
+    void unpublish_shared_index(std::string name)
+    {
+        DOCVIEW_API_CALL("docview::unpublish_shared_index");
+        std::string control_name = shared_index_object_name(name, 0);
+        shared_memory control(control_name, O_RDWR);
+        if (control.fd < 0 || flock(control.fd, LOCK_EX) != 0)
+            return;
+
+        // Remove the current generation first, so that readers can't find it through control segment
+        struct stat status;
+        if (fstat(control.fd, &status) == 0 && (std::size_t)status.st_size >= sizeof(shared_index_control))
+        {
+            control.map(sizeof(shared_index_control), PROT_READ | PROT_WRITE);
+            shared_index_control* header = (shared_index_control*)control.data;
+            std::uint64_t generation = header->generation.exchange(0, std::memory_order_acq_rel);
+            if (generation)
+                shm_unlink(shared_index_object_name(name, generation).c_str());
+        }
+        shm_unlink(control_name.c_str());
+    }
+
+    shared_index::shared_index(std::string name)
+        : name(name),
+        control(nullptr),
+        data(nullptr),
+        data_size(0),
+        current_generation(0)
+    {
+        DOCVIEW_API_CALL("docview::shared_index::shared_index");
+
+        // Map the control segment read only, it's never resized after creation
+        int fd = shm_open(shared_index_object_name(name, 0).c_str(), O_RDONLY, 0);
+        if (fd < 0)
+            throw std::runtime_error("failed to open shared index " + name + ": " + std::strerror(errno));
+        struct stat status;
+        if (fstat(fd, &status) == 0 && (std::size_t)status.st_size >= sizeof(shared_index_control))
+        {
+            void* mapping = mmap(nullptr, sizeof(shared_index_control), PROT_READ, MAP_SHARED, fd, 0);
+            if (mapping != MAP_FAILED)
+                control = mapping;
+        }
+        close(fd);
+
+        const shared_index_control* header = (const shared_index_control*)control;
+        try
+        {
+            if (!header || std::memcmp(header->magic, shared_index_control_magic, sizeof(header->magic)) != 0 ||
+                header->version != shared_index_version)
+                throw std::runtime_error("shared index " + name + " isn't valid");
+            refresh();
+            if (!data)
+                throw std::runtime_error("shared index " + name + " isn't published");
+        }
+        catch (std::runtime_error&)
+        {
+            if (control)
+                munmap(control, sizeof(shared_index_control));
+            throw;
+        }
+    }
+
+    shared_index::~shared_index()
+    {
+        if (data)
+            munmap(data, data_size);
+        munmap(control, sizeof(shared_index_control));
+    }
+
+    bool shared_index::refresh()
+    {
+        DOCVIEW_API_CALL("docview::shared_index::refresh");
+        const shared_index_control* header = (const shared_index_control*)control;
+
+        // The writer might swap again before the segment is opened, then the segment is gone, so retry
+        for (int attempt = 0; attempt < 16; attempt++)
+        {
+            std::uint64_t generation = header->generation.load(std::memory_order_acquire);
+            if (generation == 0 || generation == current_generation)
+                return false;
+
+            int fd = shm_open(shared_index_object_name(name, generation).c_str(), O_RDONLY, 0);
+            if (fd < 0)
+            {
+                if (errno == ENOENT)
+                    continue;
+                throw std::runtime_error("failed to open shared index " + name + ": " + std::strerror(errno));
+            }
+            struct stat status;
+            void* mapping = MAP_FAILED;
+            if (fstat(fd, &status) == 0 && status.st_size > 0)
+                mapping = mmap(nullptr, status.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            close(fd);
+            if (mapping == MAP_FAILED)
+                throw std::runtime_error("failed to map shared index " + name + ": " + std::strerror(errno));
+            if (!validate_shared_index(mapping, status.st_size))
+            {
+                munmap(mapping, status.st_size);
+                throw std::runtime_error("shared index " + name + " isn't valid");
+            }
+
+            if (data)
+                munmap(data, data_size);
+            data = mapping;
+            data_size = status.st_size;
+            current_generation = generation;
+            return true;
+        }
+        return false;
+    }
+
+    unsigned long shared_index::generation() const
+    {
+        return current_generation;
+    }
+
+    unsigned long shared_index::size() const
+    {
+        return ((const shared_index_header*)data)->node_count;
+    }
+
+    std::vector<unsigned long> shared_index::roots() const
+    {
+        std::vector<unsigned long> nodes(((const shared_index_header*)data)->root_count);
+        for (unsigned long i = 0; i < nodes.size(); i++)
+            nodes[i] = i;
+        return nodes;
+    }
+
+    std::vector<unsigned long> shared_index::search(std::string query) const
+    {
+        DOCVIEW_API_CALL("docview::shared_index::search");
+        const shared_index_header* header = (const shared_index_header*)data;
+        const shared_index_key* keys = (const shared_index_key*)((const char*)data + header->keys_offset);
+
+        // Keys starting with the query are adjacent, beginning from the first key not less than the query
+        const shared_index_key* key = std::lower_bound(keys, keys + header->key_count, query,
+            [&](const shared_index_key& key, const std::string& query) -> bool
+            {
+                return shared_index_string_view(data, key.string) < query;
+            });
+        std::vector<unsigned long> matches;
+        for (; key != keys + header->key_count; key++)
+        {
+            if (shared_index_string_view(data, key->string).substr(0, query.size()) != query)
+                break;
+            matches.push_back(key->node);
+        }
+
+        // A node might match by both title and synonyms
+        std::sort(matches.begin(), matches.end());
+        matches.erase(std::unique(matches.begin(), matches.end()), matches.end());
+        return matches;
+    }
+
+    std::string shared_index::title(unsigned long node) const
+    {
+        return std::string(shared_index_string_view(data, shared_index_get_node(data, node).title));
+    }
+
+    std::vector<std::string> shared_index::synonyms(unsigned long node) const
+    {
+        const shared_index_node& index_node = shared_index_get_node(data, node);
+        const shared_index_header* header = (const shared_index_header*)data;
+        const shared_index_string* strings =
+            (const shared_index_string*)((const char*)data + header->synonyms_offset) + index_node.first_synonym;
+        std::vector<std::string> synonyms;
+        for (unsigned long i = 0; i < index_node.synonym_count; i++)
+            synonyms.emplace_back(shared_index_string_view(data, strings[i]));
+        return synonyms;
+    }
+
+    unsigned long shared_index::parent(unsigned long node) const
+    {
+        std::uint32_t parent = shared_index_get_node(data, node).parent;
+        return parent == UINT32_MAX ? npos : parent;
+    }
+
+    std::vector<unsigned long> shared_index::children(unsigned long node) const
+    {
+        const shared_index_node& index_node = shared_index_get_node(data, node);
+        std::vector<unsigned long> children(index_node.child_count);
+        for (unsigned long i = 0; i < children.size(); i++)
+            children[i] = index_node.first_child + i;
+        return children;
     }
 }
 
 bool docview_load_ext(const char* path)
 {
+    DOCVIEW_API_CALL("docview_load_ext");
     try
     {
         docview::load_ext(path);
@@ -576,42 +3361,132 @@ bool docview_load_ext(const char* path)
 
 void docview_unload_ext(const char* path)
 {
+    DOCVIEW_API_CALL("docview_unload_ext");
     docview::unload_ext(path);
 }
 
 bool docview_ext_is_loaded(const char* path)
 {
+    DOCVIEW_API_CALL("docview_ext_is_loaded");
     return docview::is_loaded(path);
 }
 
 docview_doc_tree_node* docview_get_docs_tree(const char* path)
 {
+    DOCVIEW_API_CALL("docview_get_docs_tree");
     return (docview_doc_tree_node*)docview::get_doc_tree(path);
 }
 
+docview_doc_tree_node** docview_get_docs_trees(const char* const* paths)
+{
+    DOCVIEW_API_CALL("docview_get_docs_trees");
+
+    // Collect the paths
+    std::vector<std::filesystem::path> path_list;
+    for (unsigned long i = 0; paths[i]; i++)
+        path_list.push_back(paths[i]);
+
+    // Call the C++ function
+    auto result = docview::get_doc_trees(path_list);
+
+    // Copy document trees from vector to array
+    docview_doc_tree_node** return_value = new docview_doc_tree_node*[result.size()];
+    for (unsigned long i = 0; i < result.size(); i++)
+        return_value[i] = (docview_doc_tree_node*)result[i];
+
+    return return_value;
+}
+
+docview_doc_tree_node* docview_get_docs_tree_with_ext(const char* path, const char* extension)
+{
+    DOCVIEW_API_CALL("docview_get_docs_tree_with_ext");
+    try
+    {
+        return (docview_doc_tree_node*)docview::get_doc_tree(path, extension);
+    }
+    catch (std::exception&)
+    {
+        return nullptr;
+    }
+}
+
+const char* const* docview_find_documents(const char* directory, unsigned int max_depth)
+{
+    DOCVIEW_API_CALL("docview_find_documents");
+
+    // Call the C++ function
+    auto result = docview::find_documents(directory, max_depth);
+
+    // Copy paths to a NULL terminated array
+    const char** paths = new const char*[result.size() + 1];
+    for (unsigned long i = 0; i < result.size(); i++)
+        paths[i] = c_str(result[i]);
+    paths[result.size()] = nullptr;
+
+    return paths;
+}
+
+void docview_release_docs_tree(const docview_doc_tree_node* root)
+{
+    DOCVIEW_API_CALL("docview_release_docs_tree");
+    docview::release_doc_tree((const docview::doc_tree_node*)root);
+}
+
+const char* docview_get_owner(const docview_doc_tree_node* node)
+{
+    DOCVIEW_API_CALL("docview_get_owner");
+    try
+    {
+        return c_str(docview::get_owner((const docview::doc_tree_node*)node));
+    }
+    catch (std::invalid_argument&)
+    {
+        return nullptr;
+    }
+}
+
+bool docview_get_applicability_level(const char* path, docview_extension_applicability_level* level)
+{
+    DOCVIEW_API_CALL("docview_get_applicability_level");
+    try
+    {
+        *level = (docview_extension_applicability_level)docview::get_applicability_level(path);
+        return true;
+    }
+    catch (std::invalid_argument&)
+    {
+        return false;
+    }
+}
+
 docview_document docview_get_doc(docview_doc_tree_node* node)
 {
+    DOCVIEW_API_CALL("docview_get_doc");
     auto document = docview::get_doc((docview::doc_tree_node*)node);
     return {c_str(document.first), document.second};
 }
 
 const char* docview_get_brief(docview_doc_tree_node* node)
 {
+    DOCVIEW_API_CALL("docview_get_brief");
     return c_str(docview::brief((docview::doc_tree_node*)node));
 }
 
 const char* docview_get_details(docview_doc_tree_node* node)
 {
+    DOCVIEW_API_CALL("docview_get_details");
     return c_str(docview::details((docview::doc_tree_node*)node));
 }
 
 const char* docview_get_section(docview_doc_tree_node* node, const char* section)
 {
+    DOCVIEW_API_CALL("docview_get_section");
     return c_str(docview::section((docview::doc_tree_node*)node, section));
 }
 
 const docview_doc_tree_node* const* docview_search(const char* query)
 {
+    DOCVIEW_API_CALL("docview_search");
 
     // Call the C++ function
     auto result = docview::search(query);
@@ -630,11 +3505,329 @@ const docview_doc_tree_node* const* docview_search(const char* query)
     return return_value;
 }
 
+const docview_doc_tree_node* const* docview_lookup(const char* name)
+{
+    DOCVIEW_API_CALL("docview_lookup");
+
+    // Call the C++ function
+    auto result = docview::lookup(name);
+
+    // Copy nodes to an array terminated with a NULL or nullptr
+    const docview_doc_tree_node** return_value =
+        (const docview_doc_tree_node**)new docview_doc_tree_node*[result.size() + 1];
+    for (unsigned long i = 0; i < result.size(); i++)
+        return_value[i] = (docview_doc_tree_node*)result[i];
+    return_value[result.size()] = nullptr;
+
+    return return_value;
+}
+
+const docview_doc_tree_node* const* docview_search_substring(const char* query)
+{
+    DOCVIEW_API_CALL("docview_search_substring");
+
+    // Call the C++ function
+    auto result = docview::search_substring(query);
+
+    // Copy nodes to an array terminated with a NULL or nullptr
+    const docview_doc_tree_node** return_value =
+        (const docview_doc_tree_node**)new docview_doc_tree_node*[result.size() + 1];
+    for (unsigned long i = 0; i < result.size(); i++)
+        return_value[i] = (docview_doc_tree_node*)result[i];
+    return_value[result.size()] = nullptr;
+
+    return return_value;
+}
+
+const docview_doc_tree_node* const* docview_search_fuzzy(const char* query, unsigned int max_distance)
+{
+    DOCVIEW_API_CALL("docview_search_fuzzy");
+
+    // Call the C++ function
+    auto result = docview::search_fuzzy(query, max_distance);
+
+    // Copy nodes to an array terminated with a NULL or nullptr
+    const docview_doc_tree_node** return_value =
+        (const docview_doc_tree_node**)new docview_doc_tree_node*[result.size() + 1];
+    for (unsigned long i = 0; i < result.size(); i++)
+        return_value[i] = (docview_doc_tree_node*)result[i];
+    return_value[result.size()] = nullptr;
+
+    return return_value;
+}
+
+const docview_doc_tree_node* const* docview_search_regex(const char* pattern)
+{
+    DOCVIEW_API_CALL("docview_search_regex");
+
+    // Call the C++ function, return NULL if the pattern is invalid
+    std::vector<const docview::doc_tree_node*> result;
+    try
+    {
+        result = docview::search_regex(pattern);
+    }
+    catch (std::invalid_argument&)
+    {
+        return nullptr;
+    }
+
+    // Copy nodes to an array terminated with a NULL or nullptr
+    const docview_doc_tree_node** return_value =
+        (const docview_doc_tree_node**)new docview_doc_tree_node*[result.size() + 1];
+    for (unsigned long i = 0; i < result.size(); i++)
+        return_value[i] = (docview_doc_tree_node*)result[i];
+    return_value[result.size()] = nullptr;
+
+    return return_value;
+}
+
+const docview_doc_tree_node* const* docview_search_path(const char* query)
+{
+    DOCVIEW_API_CALL("docview_search_path");
+
+    // Call the C++ function
+    auto result = docview::search_path(query);
+
+    // Copy nodes to an array terminated with a NULL or nullptr
+    const docview_doc_tree_node** return_value =
+        (const docview_doc_tree_node**)new docview_doc_tree_node*[result.size() + 1];
+    for (unsigned long i = 0; i < result.size(); i++)
+        return_value[i] = (docview_doc_tree_node*)result[i];
+    return_value[result.size()] = nullptr;
+
+    return return_value;
+}
+
+const docview_doc_tree_node* const* docview_search_within(const docview_doc_tree_node* node, const char* query)
+{
+    DOCVIEW_API_CALL("docview_search_within");
+
+    // Call the C++ function, return NULL if the node isn't in a loaded tree
+    std::vector<const docview::doc_tree_node*> result;
+    try
+    {
+        result = docview::search_within((const docview::doc_tree_node*)node, query);
+    }
+    catch (std::invalid_argument&)
+    {
+        return nullptr;
+    }
+
+    // Copy nodes to an array terminated with a NULL or nullptr
+    const docview_doc_tree_node** return_value =
+        (const docview_doc_tree_node**)new docview_doc_tree_node*[result.size() + 1];
+    for (unsigned long i = 0; i < result.size(); i++)
+        return_value[i] = (docview_doc_tree_node*)result[i];
+    return_value[result.size()] = nullptr;
+
+    return return_value;
+}
+
 bool docview_validate(const docview_doc_tree_node* node)
 {
+    DOCVIEW_API_CALL("docview_validate");
     return docview::validate((docview::doc_tree_node*)node);
 }
 
+const char* docview_export_trace()
+{
+    return c_str(docview::export_trace());
+}
+
+docview_statistics docview_stats()
+{
+    DOCVIEW_API_CALL("docview_stats");
+    docview::statistics stats = docview::stats();
+    return {
+        stats.loaded_extensions,
+        stats.thread_safe_extensions,
+        stats.c_extensions,
+        stats.roots,
+        stats.nodes,
+        stats.c_extension_nodes,
+        stats.c_extension_lookup_hits,
+        stats.c_extension_lookup_misses,
+        stats.pool_threads,
+        stats.pool_queued_tasks,
+        stats.pool_tasks_run,
+        stats.pool_tasks_stolen,
+        stats.shared_index_generation,
+        stats.shared_index_bytes,
+        stats.index_terms,
+        stats.index_trigrams,
+        stats.index_pending_roots,
+        stats.index_lookups
+    };
+}
+
+docview_allocation_count* docview_get_allocation_counts()
+{
+
+    // Call the C++ function
+    auto result = docview::get_allocation_counts();
+
+    // Copy counts from vector to array
+    docview_allocation_count* return_value = new docview_allocation_count[result.size() + 1];
+    for (unsigned long i = 0; i < result.size(); i++)
+        return_value[i] = {c_str(result[i].name), result[i].api, result[i].allocations, result[i].bytes};
+
+    // Terminate the array with an element with NULL name
+    return_value[result.size()] = {nullptr, false, 0, 0};
+
+    return return_value;
+}
+
+void docview_reset_allocation_counts()
+{
+    docview::reset_allocation_counts();
+}
+
+unsigned long docview_publish_shared_index(const char* name)
+{
+    DOCVIEW_API_CALL("docview_publish_shared_index");
+    try
+    {
+        return docview::publish_shared_index(name);
+    }
+    catch (std::exception&)
+    {
+        return 0;
+    }
+}
+
+void docview_unpublish_shared_index(const char* name)
+{
+    DOCVIEW_API_CALL("docview_unpublish_shared_index");
+    try
+    {
+        docview::unpublish_shared_index(name);
+    }
+    catch (std::invalid_argument&)
+    {
+    }
+}
+
+docview_shared_index* docview_open_shared_index(const char* name)
+{
+    DOCVIEW_API_CALL("docview_open_shared_index");
+    try
+    {
+        return new docview::shared_index(name);
+    }
+    catch (std::exception&)
+    {
+        return nullptr;
+    }
+}
+
+void docview_close_shared_index(docview_shared_index* index)
+{
+    delete (docview::shared_index*)index;
+}
+
+bool docview_shared_index_refresh(docview_shared_index* index)
+{
+    DOCVIEW_API_CALL("docview_shared_index_refresh");
+    try
+    {
+        return ((docview::shared_index*)index)->refresh();
+    }
+    catch (std::runtime_error&)
+    {
+        return false;
+    }
+}
+
+unsigned long docview_shared_index_generation(docview_shared_index* index)
+{
+    return ((docview::shared_index*)index)->generation();
+}
+
+unsigned long docview_shared_index_size(docview_shared_index* index)
+{
+    return ((docview::shared_index*)index)->size();
+}
+
+const unsigned long* docview_shared_index_search(docview_shared_index* index, const char* query)
+{
+    DOCVIEW_API_CALL("docview_shared_index_search");
+
+    // Call the C++ function
+    auto result = ((docview::shared_index*)index)->search(query);
+
+    // Copy node numbers to an array terminated with DOCVIEW_SHARED_INDEX_NPOS
+    unsigned long* return_value = new unsigned long[result.size() + 1];
+    std::copy(result.begin(), result.end(), return_value);
+    return_value[result.size()] = DOCVIEW_SHARED_INDEX_NPOS;
+
+    return return_value;
+}
+
+const char* docview_shared_index_title(docview_shared_index* index, unsigned long node)
+{
+    try
+    {
+        return c_str(((docview::shared_index*)index)->title(node));
+    }
+    catch (std::invalid_argument&)
+    {
+        return nullptr;
+    }
+}
+
+const char* const* docview_shared_index_synonyms(docview_shared_index* index, unsigned long node)
+{
+    std::vector<std::string> result;
+    try
+    {
+        result = ((docview::shared_index*)index)->synonyms(node);
+    }
+    catch (std::invalid_argument&)
+    {
+        return nullptr;
+    }
+
+    // Copy strings to a NULL terminated array
+    const char** synonyms = new const char*[result.size() + 1];
+    for (unsigned long i = 0; i < result.size(); i++)
+        synonyms[i] = c_str(result[i]);
+    synonyms[result.size()] = nullptr;
+
+    return synonyms;
+}
+
+unsigned long docview_shared_index_parent(docview_shared_index* index, unsigned long node)
+{
+    try
+    {
+        return ((docview::shared_index*)index)->parent(node);
+    }
+    catch (std::invalid_argument&)
+    {
+        return DOCVIEW_SHARED_INDEX_NPOS;
+    }
+}
+
+const unsigned long* docview_shared_index_children(docview_shared_index* index, unsigned long node)
+{
+    std::vector<unsigned long> result;
+    try
+    {
+        result = ((docview::shared_index*)index)->children(node);
+    }
+    catch (std::invalid_argument&)
+    {
+        return nullptr;
+    }
+
+    // Copy node numbers to an array terminated with DOCVIEW_SHARED_INDEX_NPOS
+    unsigned long* children = new unsigned long[result.size() + 1];
+    std::copy(result.begin(), result.end(), children);
+    children[result.size()] = DOCVIEW_SHARED_INDEX_NPOS;
+
+    return children;
+}
+
 docview_doc_tree_node* docview_doc_tree_node_parent(docview_doc_tree_node* node)
 {
     return (docview_doc_tree_node*)((docview::doc_tree_node*)node)->parent;